@@ -0,0 +1 @@
+LAST_COVERAGE = 0
@@ -12,12 +12,14 @@
 #include <limits.h>
 #include <poll.h>
 #include <signal.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/epoll.h>
 #include <sys/inotify.h>
 #include <sys/signalfd.h>
 #include <sys/stat.h>
+#include <sys/timerfd.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <wchar.h>
@@ -38,29 +40,43 @@ static void save_current_position(struct application *app)
 	}
 }
 
-static void select_filename(struct application *app, const char *filename)
+static bool select_filename(struct application *app, const char *filename)
 {
 	size_t index;
 
 	if(!dirmodel_get_index(&app->model, filename, &index))
-		return;
+		return false;
 	if(index == listmodel_count(&app->model.listmodel))
 		index--;
 	listview_setindex(&app->view, index);
 	listview_refresh(&app->view);
+	return true;
+}
+
+static void clear_pending_selection(struct application *app)
+{
+	free(app->pending_selection);
+	app->pending_selection = NULL;
 }
 
 static void select_stored_position(struct application *app, const char *oldfilename)
 {
 	const char *filename;
 
+	clear_pending_selection(app);
+
 	if(oldfilename)
 		filename = oldfilename;
 	else
 		filename = dict_get(app->stored_positions, path_tocstr(&app->cwd));
 
-	if(filename)
-		select_filename(app, filename);
+	if(filename == NULL || select_filename(app, filename))
+		return;
+
+	/* the file may just not be loaded yet, so try again after each batch,
+	 * until the user moves on */
+	if(dirmodel_isloading(&app->model))
+		app->pending_selection = strdup(filename);
 }
 
 static void display_current_path(struct application *app)
@@ -71,6 +87,11 @@ static void display_current_path(struct application *app)
 	wrefresh(app->pathbar);
 }
 
+static void print_load_error(struct application *app)
+{
+	wprintw(app->status, "Cannot read the whole directory: %s", strerror(app->load_error));
+}
+
 static void refresh_statusbar(struct application *app)
 {
 	werase(app->status);
@@ -97,14 +118,28 @@ static void refresh_statusbar(struct application *app)
 			markedstatswidth = 0;
 		}
 
-		size_t rightwidth = snprintf(NULL, 0, " %zu/%zu %ls%s", pos, count, dirsize, markedstats);
+		/* entries not stat'ed yet are missing in the directory size */
+		const char *dirsize_incomplete = dirmodel_getpendingcount(&app->model) > 0 ? "+" : "";
+
+		/* the count grows, while the directory is still being loaded */
+		const char *loading = dirmodel_isloading(&app->model) ? "..." : "";
+
+		/* changes per second and how long they are collected */
+		char refreshstats[32] = "";
+		if(app->show_refresh_stats)
+			sprintf(refreshstats, " [%u/s %ums]", app->refresh.rate, app->refresh.window);
+
+		size_t rightwidth = snprintf(NULL, 0, "%s %zu/%zu%s %ls%s%s", refreshstats, pos, count, loading, dirsize, dirsize_incomplete, markedstats);
 		char right[rightwidth + 1];
 
-		sprintf(right, " %zu/%zu %ls%s", pos, count, dirsize, markedstats);
+		sprintf(right, "%s %zu/%zu%s %ls%s%s", refreshstats, pos, count, loading, dirsize, dirsize_incomplete, markedstats);
 
 		size_t width = getmaxx(app->status);
 		if(rightwidth >= width) {
 			mvwprintw(app->status, 0, 0, "%s", right + rightwidth - width);
+		} else if(app->load_error != 0) {
+			print_load_error(app);
+			mvwprintw(app->status, 0, width - rightwidth, "%s", right);
 		} else {
 			const struct filedata *filedata = dirmodel_getfiledata(&app->model, listview_getindex(&app->view));
 			char left [FILEDATA_FORMAT_OUTPUT_BUFFER_SIZE];
@@ -124,6 +159,8 @@ static void refresh_statusbar(struct application *app)
 			}
 			mvwchgat(app->status, 0, colorstart, colorwidth, 0, 2, NULL);
 		}
+	} else if(app->load_error != 0) {
+		print_load_error(app);
 	}
 	wrefresh(app->status);
 }
@@ -161,7 +198,7 @@ static bool enter_directory(struct application *app, const char *oldpathname)
 				);
 		}
 
-		if(chdir(cwd) == 0 && dirmodel_change_directory(&app->model, cwd))
+		if(chdir(cwd) == 0 && dirmodel_begin_change_directory(&app->model, cwd))
 			break;
 
 		if(strcmp(cwd, "/") == 0) {
@@ -172,6 +209,7 @@ static bool enter_directory(struct application *app, const char *oldpathname)
 		path_remove_component(&app->cwd, &oldpathname);
 	}
 
+	app->load_error = 0;
 	update_terminal_title(app);
 	select_stored_position(app, oldpathname);
 	display_current_path(app);
@@ -189,6 +227,33 @@ static bool reload_directory(struct application *app)
 	return enter_directory(app, NULL);
 }
 
+/* Shows the loaded entries in a new order or with a new filter without
+ * reading the directory again, keeping the cursor on the same file, if it
+ * is still shown. */
+static void rearrange_directory(struct application *app)
+{
+	char *filename = NULL;
+
+	if(listmodel_count(&app->model.listmodel) != 0)
+		filename = strdup(dirmodel_getfilename(&app->model, listview_getindex(&app->view)));
+
+	if(dirmodel_rearrange(&app->model) != 0) {
+		free(filename);
+		reload_directory(app);
+		return;
+	}
+
+	if(filename) {
+		select_filename(app, filename);
+		free(filename);
+	}
+	listview_refresh(&app->view);
+	if(app->mode == MODE_NORMAL)
+		refresh_statusbar(app);
+	else
+		commandline_updatecursor(&app->commandline);
+}
+
 static void unblock_signals(void)
 {
 	sigset_t sigset;
@@ -196,7 +261,6 @@ static void unblock_signals(void)
 	sigemptyset(&sigset);
 	sigaddset(&sigset, SIGWINCH);
 	sigaddset(&sigset, SIGCHLD);
-	sigaddset(&sigset, SIGALRM);
 	sigprocmask(SIG_UNBLOCK, &sigset, NULL);
 }
 
@@ -481,6 +545,19 @@ static void command_mkdir(struct commandexecutor *commandexecutor, char *dirname
 	}
 }
 
+static void insert_into_commandline(struct application *app, const char *text)
+{
+	size_t length = mbstowcs(NULL, text, 0);
+
+	if(length != (size_t)-1) {
+		wchar_t buffer[length + 1];
+		mbstowcs(buffer, text, length);
+
+		for(size_t i = 0; i < length; i++)
+			commandline_handlekey(&app->commandline, buffer[i], false);
+	}
+}
+
 static void command_cmdline(struct commandexecutor *commandexecutor, char *command)
 {
 	struct application *app = container_of(commandexecutor, struct application, commandexecutor);
@@ -488,18 +565,216 @@ static void command_cmdline(struct commandexecutor *commandexecutor, char *comma
 	curs_set(1);
 	commandline_start(&app->commandline, L':');
 
-	if(command != NULL) {
-		size_t length = mbstowcs(NULL, command, 0);
-		if(length != (size_t)-1) {
-			wchar_t buffer[length + 1];
-			mbstowcs(buffer, command, length);
+	if(command != NULL)
+		insert_into_commandline(app, command);
+}
 
-			for(size_t i = 0; i < length; i++)
-				commandline_handlekey(&app->commandline, buffer[i], false);
-		}
+/* Every change of the pattern is shown at once. Like with the filter
+ * command, a pattern, that is not a valid regex (yet), shows all files. */
+static void update_live_filter(struct application *app)
+{
+	const wchar_t *wpattern = commandline_getcommand(&app->commandline);
+	size_t length = wcstombs(NULL, wpattern, 0);
+
+	if(length == (size_t)-1)
+		return;
+
+	char pattern[length + 1];
+	wcstombs(pattern, wpattern, sizeof(pattern));
+	dirmodel_setfilter(&app->model, length > 0 ? pattern : NULL);
+	rearrange_directory(app);
+}
+
+/* Keeps the filter, that was typed, or goes back to the one from before. */
+static void end_live_filter(struct application *app, bool confirmed)
+{
+	app->live_filter = false;
+	if(!confirmed) {
+		dirmodel_setfilter(&app->model, app->live_filter_previous);
+		rearrange_directory(app);
+	}
+	free(app->live_filter_previous);
+	app->live_filter_previous = NULL;
+}
+
+static void command_live_filter(struct commandexecutor *commandexecutor, char *pattern)
+{
+	struct application *app = container_of(commandexecutor, struct application, commandexecutor);
+	const char *previous = dirmodel_getfilter(&app->model);
+
+	free(app->live_filter_previous);
+	app->live_filter_previous = NULL;
+	if(previous) {
+		app->live_filter_previous = strdup(previous);
+		if(app->live_filter_previous == NULL)
+			return;
+	}
+
+	app->mode = MODE_COMMAND;
+	app->live_filter = true;
+	curs_set(1);
+	commandline_start(&app->commandline, L'|');
+
+	if(pattern != NULL) {
+		insert_into_commandline(app, pattern);
+		update_live_filter(app);
+	} else if(previous) {
+		insert_into_commandline(app, app->live_filter_previous);
 	}
 }
 
+/* While the fuzzy finder is open, its view covers the listing. */
+static struct listview *shown_view(struct application *app)
+{
+	return app->fuzzy_find ? &app->fuzzy_view : &app->view;
+}
+
+static void update_fuzzy_find(struct application *app)
+{
+	const wchar_t *wquery = commandline_getcommand(&app->commandline);
+	size_t length = wcstombs(NULL, wquery, 0);
+
+	if(length == (size_t)-1)
+		return;
+
+	char query[length + 1];
+	wcstombs(query, wquery, sizeof(query));
+	if(fuzzymodel_setquery(&app->fuzzy, query) != 0)
+		return;
+
+	listview_refresh(&app->fuzzy_view);
+	commandline_updatecursor(&app->commandline);
+}
+
+/* Goes back to the listing, positioned on the chosen file, if confirmed. */
+static void end_fuzzy_find(struct application *app, bool confirmed)
+{
+	size_t index = listview_getindex(&app->fuzzy_view);
+
+	if(confirmed && index < listmodel_count(&app->fuzzy.listmodel))
+		select_filename(app, fuzzymodel_getfilename(&app->fuzzy, index));
+
+	app->fuzzy_find = false;
+	listview_destroy(&app->fuzzy_view);
+	fuzzymodel_destroy(&app->fuzzy);
+
+	app->view.needs_refresh = true;
+	listview_refresh(&app->view);
+	refresh_statusbar(app);
+}
+
+/* Files, that were added or removed meanwhile, are found or dropped as
+ * well. */
+static void refresh_fuzzy_find(struct application *app)
+{
+	if(app->fuzzy_find && !app->fuzzy.candidates_valid)
+		update_fuzzy_find(app);
+}
+
+static void command_fuzzy_find(struct commandexecutor *commandexecutor, char *query)
+{
+	struct application *app = container_of(commandexecutor, struct application, commandexecutor);
+
+	if(!fuzzymodel_init(&app->fuzzy, &app->model))
+		return;
+	if(fuzzymodel_setquery(&app->fuzzy, "") != 0)
+		goto err_model;
+	if(!listview_init(&app->fuzzy_view, &app->fuzzy.listmodel, 0, 1, COLS, LINES - 2))
+		goto err_model;
+
+	app->mode = MODE_COMMAND;
+	app->fuzzy_find = true;
+	curs_set(1);
+	commandline_start(&app->commandline, L'>');
+
+	if(query != NULL) {
+		insert_into_commandline(app, query);
+		update_fuzzy_find(app);
+	}
+	return;
+
+err_model:
+	fuzzymodel_destroy(&app->fuzzy);
+}
+
+/* Moves the cursor to the first file starting with the typed text, which
+ * stays where it is, as long as there is none. */
+static void update_type_ahead(struct application *app)
+{
+	const wchar_t *wprefix = commandline_getcommand(&app->commandline);
+	size_t length = wcstombs(NULL, wprefix, 0);
+	size_t index;
+
+	if(length == (size_t)-1)
+		return;
+
+	char prefix[length + 1];
+	wcstombs(prefix, wprefix, sizeof(prefix));
+	if(!dirmodel_find_prefix(&app->model, prefix, &index))
+		return;
+
+	listview_setindex(&app->view, index);
+	listview_refresh(&app->view);
+	refresh_statusbar(app);
+	commandline_updatecursor(&app->commandline);
+}
+
+/* Stays on the file found or goes back to where the cursor was. */
+static void end_type_ahead(struct application *app, bool confirmed)
+{
+	size_t count = listmodel_count(&app->model.listmodel);
+
+	app->type_ahead = false;
+	if(confirmed || count == 0)
+		return;
+
+	listview_setindex(&app->view, app->type_ahead_origin < count ? app->type_ahead_origin : count - 1);
+	listview_refresh(&app->view);
+	refresh_statusbar(app);
+}
+
+static void command_type_ahead(struct commandexecutor *commandexecutor, char *prefix)
+{
+	struct application *app = container_of(commandexecutor, struct application, commandexecutor);
+
+	app->mode = MODE_COMMAND;
+	app->type_ahead = true;
+	app->type_ahead_origin = listview_getindex(&app->view);
+	curs_set(1);
+	commandline_start(&app->commandline, L'^');
+
+	if(prefix != NULL) {
+		insert_into_commandline(app, prefix);
+		update_type_ahead(app);
+	}
+}
+
+/* Shows the effect of the command line, while it is typed, for the commands
+ * that do so. */
+static void commandline_changed(struct application *app)
+{
+	if(app->live_filter)
+		update_live_filter(app);
+	else if(app->fuzzy_find)
+		update_fuzzy_find(app);
+	else if(app->type_ahead)
+		update_type_ahead(app);
+}
+
+/* Returns false, if the command line holds a command to execute. */
+static bool commandline_finished(struct application *app, bool confirmed)
+{
+	if(app->live_filter)
+		end_live_filter(app, confirmed);
+	else if(app->fuzzy_find)
+		end_fuzzy_find(app, confirmed);
+	else if(app->type_ahead)
+		end_type_ahead(app, confirmed);
+	else
+		return false;
+	return true;
+}
+
 static void command_rename(struct commandexecutor *commandexecutor, char *newfilename)
 {
 	struct application *app = container_of(commandexecutor, struct application, commandexecutor);
@@ -560,7 +835,7 @@ static void command_filter(struct commandexecutor *commandexecutor, char *regex)
 {
 	struct application *app = container_of(commandexecutor, struct application, commandexecutor);
 	dirmodel_setfilter(&app->model, regex);
-	enter_directory(app, NULL);
+	rearrange_directory(app);
 }
 
 static void command_sort(struct commandexecutor *commandexecutor, char *mode_string)
@@ -582,7 +857,44 @@ static void command_sort(struct commandexecutor *commandexecutor, char *mode_str
 	else
 		return;
 	dirmodel_set_sort_mode(&app->model, mode);
-	enter_directory(app, NULL);
+	rearrange_directory(app);
+}
+
+static void command_load_mode(struct commandexecutor *commandexecutor, char *mode_string)
+{
+	struct application *app = container_of(commandexecutor, struct application, commandexecutor);
+	enum dirmodel_load_mode mode;
+	if(strcmp(mode_string, "full") == 0)
+		mode = DIRMODEL_LOAD_FULL;
+	else if(strcmp(mode_string, "deferred") == 0)
+		mode = DIRMODEL_LOAD_DEFERRED;
+	else
+		return;
+	dirmodel_set_load_mode(&app->model, mode);
+	reload_directory(app);
+}
+
+static void command_sort_cache(struct commandexecutor *commandexecutor, char *size_string)
+{
+	struct application *app = container_of(commandexecutor, struct application, commandexecutor);
+	char *end;
+
+	unsigned long size = strtoul(size_string, &end, 10);
+	if(end == size_string || *end != '\0' || size > SIZE_MAX / (1024 * 1024))
+		return;
+	dirmodel_set_sortcache_limit(&app->model, size * 1024 * 1024);
+}
+
+static void command_refresh_stats(struct commandexecutor *commandexecutor, char *state)
+{
+	struct application *app = container_of(commandexecutor, struct application, commandexecutor);
+	if(strcmp(state, "on") == 0)
+		app->show_refresh_stats = true;
+	else if(strcmp(state, "off") == 0)
+		app->show_refresh_stats = false;
+	else
+		return;
+	refresh_statusbar(app);
 }
 
 static void command_map(struct commandexecutor *commandexecutor, char *keymapstring)
@@ -622,8 +934,14 @@ struct command_map application_command_map[] = {
 	{ "search_next", command_search_next, false },
 	{ "search_reverse", command_search_reverse, true },
 	{ "filter", command_filter, false },
+	{ "live_filter", command_live_filter, false },
+	{ "fuzzy_find", command_fuzzy_find, false },
+	{ "type_ahead", command_type_ahead, false },
 	{ "map", command_map, true },
 	{ "sort", command_sort, true },
+	{ "load_mode", command_load_mode, true },
+	{ "sort_cache", command_sort_cache, true },
+	{ "refresh_stats", command_refresh_stats, true },
 	{ "reload", command_reload, false },
 	{ NULL, NULL, false },
 };
@@ -634,16 +952,7 @@ static void insert_current_file_into_commandline(struct application *app)
 		return;
 
 	size_t index = listview_getindex(&app->view);
-	const char *filename = dirmodel_getfilename(&app->model, index);
-	size_t length = mbstowcs(NULL, filename, 0);
-
-	if(length != (size_t)-1) {
-		wchar_t buffer[length + 1];
-		mbstowcs(buffer, filename, length);
-
-		for(size_t i = 0; i < length; i++)
-			commandline_handlekey(&app->commandline, buffer[i], false);
-	}
+	insert_into_commandline(app, dirmodel_getfilename(&app->model, index));
 }
 
 static void handle_stdin(struct application *app)
@@ -655,12 +964,18 @@ static void handle_stdin(struct application *app)
 	if(ret == ERR)
 		return;
 
+	/* the user took over, do not jump around anymore */
+	clear_pending_selection(app);
+
 	if(app->mode == MODE_COMMAND) {
 		if(ret != KEY_CODE_YES && key == L'\n') {
 			app->mode = MODE_NORMAL;
 			curs_set(0);
 			refresh_statusbar(app);
 
+			if(commandline_finished(app, true))
+				return;
+
 			const wchar_t *wcommand = commandline_getcommand(&app->commandline);
 			char command[wcstombs(NULL, wcommand, 0) + 1];
 			wcstombs(command, wcommand, sizeof(command));
@@ -674,17 +989,52 @@ static void handle_stdin(struct application *app)
 				curs_set(0);
 				werase(app->status);
 				wrefresh(app->status);
+				commandline_finished(app, false);
 				return;
 			}
 			if(ret != KEY_CODE_YES && key == L'\n')
 				insert_current_file_into_commandline(app);
-		} else
+			commandline_changed(app);
+		} else {
 			commandline_handlekey(&app->commandline, key, ret == KEY_CODE_YES ? true : false);
+			commandline_changed(app);
+		}
 
 	} else
 		keymap_handlekey(&app->keymap, key, ret == KEY_CODE_YES ? true : false);
 }
 
+/* Sets the timer to when the scheduler wants the next flush or stops it. */
+static void set_refresh_timer(struct application *app)
+{
+	struct itimerspec timer;
+
+	memset(&timer, 0, sizeof(timer));
+	if(app->refresh.scheduled) {
+		/* a zero time would stop the timer */
+		uint64_t due = app->refresh.due > 0 ? app->refresh.due : 1;
+		timer.it_value.tv_sec = due / 1000;
+		timer.it_value.tv_nsec = due % 1000 * 1000000;
+	}
+	timerfd_settime(app->refresh_fd, TFD_TIMER_ABSTIME, &timer, NULL);
+}
+
+/* Applies the changes in the directory collected since the last flush. */
+static void flush_changes(struct application *app)
+{
+	dirmodel_notify_flush(&app->model);
+	/* files, that change too often, wait for a later flush */
+	refreshscheduler_flushed(&app->refresh, monotonic_ms(), dirmodel_getqueuedcount(&app->model) > 0);
+	set_refresh_timer(app);
+
+	refresh_fuzzy_find(app);
+	listview_refresh(shown_view(app));
+	if(app->mode == MODE_NORMAL)
+		refresh_statusbar(app);
+	else
+		commandline_updatecursor(&app->commandline);
+}
+
 static void handle_signal(struct application *app)
 {
 	struct signalfd_siginfo info;
@@ -701,7 +1051,9 @@ static void handle_signal(struct application *app)
 		wresize(app->status, 1, COLS);
 		wresize(app->pathbar, 1, COLS);
 		listview_resize(&app->view, COLS, LINES - 2);
-		listview_refresh(&app->view);
+		if(app->fuzzy_find)
+			listview_resize(&app->fuzzy_view, COLS, LINES - 2);
+		listview_refresh(shown_view(app));
 		commandline_resize(&app->commandline, 0, LINES - 1, COLS);
 		display_current_path(app);
 		if(app->mode == MODE_NORMAL)
@@ -714,24 +1066,60 @@ static void handle_signal(struct application *app)
 			processmanager_waitpid(&app->pm, info.ssi_pid, &status);
 		}
 		break;
-	case SIGALRM:
-		app->timer_running = false;
-		dirmodel_notify_flush(&app->model);
-		listview_refresh(&app->view);
-		if(app->mode == MODE_NORMAL)
-			refresh_statusbar(app);
-		else
-			commandline_updatecursor(&app->commandline);
-		break;
 	}
 }
 
+static void handle_refresh_timer(struct application *app)
+{
+	uint64_t expirations;
+
+	if(read(app->refresh_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+		return;
+	flush_changes(app);
+}
+
+static void handle_loader(struct application *app)
+{
+	int ret = dirmodel_collect_batches(&app->model);
+
+	/* the directory could not be opened in the first place */
+	if(ret != 0 && ret != ENOMEM && !dirmodel_isopen(&app->model)) {
+		const char *oldpathname = NULL;
+
+		clear_pending_selection(app);
+		if(strcmp(path_tocstr(&app->cwd), "/") == 0) {
+			puts("Cannot even open \"/\", exiting");
+			app->running = false;
+			return;
+		}
+		path_remove_component(&app->cwd, &oldpathname);
+		enter_directory(app, oldpathname);
+		return;
+	}
+	/* otherwise it is shown as far as it got */
+	if(ret != 0)
+		app->load_error = ret;
+
+	if(app->pending_selection) {
+		if(select_filename(app, app->pending_selection) || !dirmodel_isloading(&app->model))
+			clear_pending_selection(app);
+	}
+
+	refresh_fuzzy_find(app);
+	listview_refresh(shown_view(app));
+	if(app->mode == MODE_NORMAL)
+		refresh_statusbar(app);
+	else
+		commandline_updatecursor(&app->commandline);
+}
+
 static void handle_inotify(struct application *app)
 {
 	char buf[4096]
 		__attribute__((aligned(__alignof(struct inotify_event))));
 	char *ptr;
 	const struct inotify_event *event;
+	size_t count = 0;
 	ssize_t len;
 
 	len = read(app->inotify_fd, &buf, sizeof(buf));
@@ -747,6 +1135,7 @@ static void handle_inotify(struct application *app)
 		}
 		if(event->wd != app->inotify_watch)
 			continue;
+		count++;
 
 		if(event->mask & IN_MOVED_FROM && listmodel_count(&app->model.listmodel) != 0) {
 			size_t index = listview_getindex(&app->view);
@@ -772,22 +1161,23 @@ static void handle_inotify(struct application *app)
 	if(app->mode == MODE_COMMAND)
 		commandline_updatecursor(&app->commandline);
 
-	if(!app->timer_running) {
-		app->refresh_timer.it_value.tv_sec = 0;
-		app->refresh_timer.it_value.tv_usec = 50000;
-		app->refresh_timer.it_interval.tv_sec = 0;
-		app->refresh_timer.it_interval.tv_usec = 0;
-		setitimer(ITIMER_REAL, &app->refresh_timer, NULL);
-		app->timer_running = true;
+	uint64_t now = monotonic_ms();
+	if(refreshscheduler_add_events(&app->refresh, now, count)) {
+		if(refreshscheduler_isdue(&app->refresh, now))
+			flush_changes(app);
+		else
+			set_refresh_timer(app);
 	}
 }
 
 void application_run(struct application *app)
 {
-	struct epoll_event pollfds[3] = {
+	struct epoll_event pollfds[5] = {
 		{ .events = EPOLLIN, .data.fd = 0, },
 		{ .events = EPOLLIN, .data.fd = app->signal_fd, },
 		{ .events = EPOLLIN, .data.fd = app->inotify_fd, },
+		{ .events = EPOLLIN, .data.fd = dirmodel_getloadfd(&app->model), },
+		{ .events = EPOLLIN, .data.fd = app->refresh_fd, },
 	};
 	struct epoll_event events[10];
 
@@ -799,10 +1189,16 @@ void application_run(struct application *app)
 		goto out;
 	if(epoll_ctl(epollfd, EPOLL_CTL_ADD, app->signal_fd, &pollfds[1]) < 0)
 		goto out;
+	if(epoll_ctl(epollfd, EPOLL_CTL_ADD, app->refresh_fd, &pollfds[4]) < 0)
+		goto out;
 	if(app->inotify_fd != -1) {
 		if(epoll_ctl(epollfd, EPOLL_CTL_ADD, app->inotify_fd, &pollfds[2]) < 0)
 			goto out;
 	}
+	if(dirmodel_getloadfd(&app->model) != -1) {
+		if(epoll_ctl(epollfd, EPOLL_CTL_ADD, dirmodel_getloadfd(&app->model), &pollfds[3]) < 0)
+			goto out;
+	}
 
 	app->running = true;
 	while(app->running) {
@@ -820,6 +1216,10 @@ void application_run(struct application *app)
 				handle_signal(app);
 			if(events[i].data.fd == app->inotify_fd)
 				handle_inotify(app);
+			if(events[i].data.fd == dirmodel_getloadfd(&app->model))
+				handle_loader(app);
+			if(events[i].data.fd == app->refresh_fd)
+				handle_refresh_timer(app);
 		}
 	}
 out:
@@ -835,7 +1235,6 @@ static int create_signalfd()
 	sigemptyset(&sigset);
 	sigaddset(&sigset, SIGWINCH);
 	sigaddset(&sigset, SIGCHLD);
-	sigaddset(&sigset, SIGALRM);
 	sigprocmask(SIG_BLOCK, &sigset, NULL);
 
 	return signalfd(-1, &sigset, SFD_CLOEXEC);
@@ -904,7 +1303,14 @@ bool application_init(struct application *app)
 
 	app->mode = MODE_NORMAL;
 	app->lastsearch_regex = NULL;
-	app->timer_running = false;
+	app->pending_selection = NULL;
+	app->live_filter = false;
+	app->live_filter_previous = NULL;
+	app->fuzzy_find = false;
+	app->type_ahead = false;
+	app->load_error = 0;
+	app->show_refresh_stats = false;
+	refreshscheduler_init(&app->refresh);
 	curs_set(0);
 
 	processmanager_init(&app->pm);
@@ -960,6 +1366,10 @@ bool application_init(struct application *app)
 	if(app->signal_fd == -1)
 		return false;
 
+	app->refresh_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if(app->refresh_fd == -1)
+		return false;
+
 	if(!application_run_rcfile(app))
 		return false;
 
@@ -969,6 +1379,12 @@ bool application_init(struct application *app)
 void application_destroy(struct application *app)
 {
 	free((void*)app->lastsearch_regex);
+	free(app->pending_selection);
+	free(app->live_filter_previous);
+	if(app->fuzzy_find) {
+		listview_destroy(&app->fuzzy_view);
+		fuzzymodel_destroy(&app->fuzzy);
+	}
 	listview_destroy(&app->view);
 	path_destroy(&app->cwd);
 	commandline_destroy(&app->commandline);
@@ -6,16 +6,17 @@
 #include "commandexecutor.h"
 #include "commandline.h"
 #include "dirmodel.h"
+#include "fuzzymodel.h"
 #include "keymap.h"
 #include "listmodel.h"
 #include "listview.h"
 #include "path.h"
 #include "processmanager.h"
+#include "refreshscheduler.h"
 
 #include <ncurses.h>
 #include <stdbool.h>
 #include <stdint.h>
-#include <sys/time.h>
 
 struct list;
 
@@ -36,8 +37,10 @@ struct application {
 	struct keymap keymap;
 	struct commandexecutor commandexecutor;
 	struct processmanager pm;
-	struct itimerval refresh_timer;
-	bool timer_running;
+	struct refreshscheduler refresh;
+	int refresh_fd;
+	/* show how busy the directory is in the status bar */
+	bool show_refresh_stats;
 	int signal_fd;
 	int inotify_fd;
 	int inotify_watch;
@@ -46,6 +49,16 @@ struct application {
 	bool running;
 	const char *lastsearch_regex;
 	int lastsearch_direction;
+	char *pending_selection;
+	bool live_filter;
+	char *live_filter_previous;
+	bool fuzzy_find;
+	struct fuzzymodel fuzzy;
+	struct listview fuzzy_view;
+	bool type_ahead;
+	size_t type_ahead_origin;
+	/* why the current directory is only shown as far as it was read */
+	int load_error;
 };
 
 void application_run(struct application *app);
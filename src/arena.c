@@ -0,0 +1,142 @@
+/* See LICENSE file for copyright and license details. */
+#include "arena.h"
+
+#include <stdlib.h>
+
+struct arena_chunk {
+	struct arena_chunk *next;
+	size_t size;
+	char data[];
+};
+
+struct arena_freeitem {
+	struct arena_freeitem *next;
+};
+
+static size_t round_size(size_t size)
+{
+	if(size < sizeof(struct arena_freeitem))
+		size = sizeof(struct arena_freeitem);
+	return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+static struct arena_chunk *arena_add_chunk(struct arena *arena, size_t size)
+{
+	struct arena_chunk *chunk = malloc(sizeof(*chunk) + size);
+	if(chunk == NULL)
+		return NULL;
+
+	chunk->size = size;
+	arena->capacity += size;
+	chunk->next = arena->chunks;
+	arena->chunks = chunk;
+	if(arena->last == NULL)
+		arena->last = chunk;
+	return chunk;
+}
+
+/* Objects larger than ARENA_MAX_SIZE get a chunk of their own, which is only
+ * released together with the arena. */
+void *arena_alloc(struct arena *arena, size_t size)
+{
+	size = round_size(size);
+
+	if(size > ARENA_MAX_SIZE) {
+		struct arena_chunk *chunk = arena_add_chunk(arena, size);
+		if(chunk == NULL)
+			return NULL;
+		arena->allocated += size;
+		return chunk->data;
+	}
+
+	struct arena_freeitem **free = &arena->free[size / ARENA_ALIGNMENT - 1];
+	if(*free) {
+		struct arena_freeitem *item = *free;
+		*free = item->next;
+		arena->allocated += size;
+		return item;
+	}
+
+	if((size_t)(arena->end - arena->next) < size) {
+		/* the rest of the current chunk is lost, which is at most
+		 * ARENA_MAX_SIZE bytes */
+		struct arena_chunk *chunk = arena_add_chunk(arena, ARENA_CHUNK_SIZE);
+		if(chunk == NULL)
+			return NULL;
+		arena->next = chunk->data;
+		arena->end = chunk->data + chunk->size;
+	}
+
+	void *ptr = arena->next;
+	arena->next += size;
+	arena->allocated += size;
+	return ptr;
+}
+
+/* size has to be the same as the one given to arena_alloc */
+void arena_free(struct arena *arena, void *ptr, size_t size)
+{
+	if(ptr == NULL)
+		return;
+
+	size = round_size(size);
+	if(size > ARENA_MAX_SIZE)
+		return;
+
+	struct arena_freeitem *item = ptr;
+	struct arena_freeitem **free = &arena->free[size / ARENA_ALIGNMENT - 1];
+	item->next = *free;
+	*free = item;
+	arena->allocated -= size;
+}
+
+/* Moves all memory of other into arena, so that objects allocated from other
+ * can be freed to and live as long as arena. other is empty afterwards. The
+ * free lists of other are dropped, their memory is released together with
+ * arena. */
+void arena_merge(struct arena *arena, struct arena *other)
+{
+	if(other->chunks == NULL)
+		return;
+
+	other->last->next = arena->chunks;
+	arena->chunks = other->chunks;
+	if(arena->last == NULL)
+		arena->last = other->last;
+	arena->capacity += other->capacity;
+	arena->allocated += other->allocated;
+
+	/* continue with whichever chunk has more room left */
+	if(other->end - other->next > arena->end - arena->next) {
+		arena->next = other->next;
+		arena->end = other->end;
+	}
+
+	arena_init(other);
+}
+
+void arena_init(struct arena *arena)
+{
+	arena->chunks = NULL;
+	arena->last = NULL;
+	arena->next = NULL;
+	arena->end = NULL;
+	for(size_t i = 0; i < ARENA_CLASSES; i++)
+		arena->free[i] = NULL;
+	arena->capacity = 0;
+	arena->allocated = 0;
+}
+
+/* Releases all objects of the arena at once, the arena can be used again
+ * afterwards. */
+void arena_destroy(struct arena *arena)
+{
+	struct arena_chunk *chunk = arena->chunks;
+
+	while(chunk) {
+		struct arena_chunk *next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+	arena_init(arena);
+}
@@ -0,0 +1,35 @@
+/* See LICENSE file for copyright and license details. */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#define ARENA_ALIGNMENT 8
+#define ARENA_MAX_SIZE 2048
+#define ARENA_CLASSES (ARENA_MAX_SIZE / ARENA_ALIGNMENT)
+
+struct arena_chunk;
+struct arena_freeitem;
+
+/* Hands out many small objects from large chunks, which are only given back
+ * to the system all at once. Freed objects are kept in a free list per size
+ * class and reused. An arena must not be used by several threads at once. */
+struct arena {
+	struct arena_chunk *chunks;
+	struct arena_chunk *last;
+	char *next;
+	char *end;
+	struct arena_freeitem *free[ARENA_CLASSES];
+	/* bytes taken from the system and bytes handed out and not freed */
+	size_t capacity;
+	size_t allocated;
+};
+
+void *arena_alloc(struct arena *arena, size_t size) __attribute__((warn_unused_result));
+void arena_free(struct arena *arena, void *ptr, size_t size);
+void arena_merge(struct arena *arena, struct arena *other);
+void arena_init(struct arena *arena);
+void arena_destroy(struct arena *arena);
+
+#endif
@@ -0,0 +1,483 @@
+/* See LICENSE file for copyright and license details. */
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+#include "dirloader.h"
+
+#include "arena.h"
+#include "filedata.h"
+#include "list.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define DIRLOADER_GETDENTS_BUFFER_SIZE (128 * 1024)
+#define DIRLOADER_MAX_BATCH_SIZE (64 * 1024)
+
+struct linux_dirent64 {
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+
+struct dirreader {
+	int fd;
+	bool defer;
+	bool eof;
+	char *buffer;
+	long length;
+	long offset;
+};
+
+/* Each batch brings its own arena, so that the worker never touches the
+ * memory of entries, that were already handed over. */
+struct dirloader_batch {
+	struct list *entries;
+	struct arena arena;
+};
+
+/* A job is shared between the loader and its worker thread. A cancelled
+ * job is just left to the worker, which may be stuck on a slow file system
+ * for a long time, and freed by whoever lets go of it last. */
+struct dirloader_job {
+	pthread_mutex_t mutex;
+	unsigned int refs;
+	atomic_bool cancelled;
+	int eventfd;
+	char *path;
+	struct dirloader_options options;
+	/* protected by mutex */
+	int dirfd;
+	struct list *batches;
+	bool finished;
+	int error;
+};
+
+static mode_t mode_from_dirent_type(unsigned char type)
+{
+	switch(type) {
+	case DT_BLK:
+		return S_IFBLK;
+	case DT_CHR:
+		return S_IFCHR;
+	case DT_DIR:
+		return S_IFDIR;
+	case DT_FIFO:
+		return S_IFIFO;
+	case DT_REG:
+		return S_IFREG;
+	case DT_SOCK:
+		return S_IFSOCK;
+	default:
+		/* symlinks need a stat to know, if they point to a directory */
+		return 0;
+	}
+}
+
+static void entries_delete(struct list *entries, struct arena *arena)
+{
+	for(size_t i = 0; i < list_length(entries); i++)
+		filedata_arena_delete(arena, list_get_item(entries, i));
+	list_delete(entries, NULL);
+}
+
+static void batch_delete(void *data)
+{
+	struct dirloader_batch *batch = data;
+
+	list_delete(batch->entries, NULL);
+	arena_destroy(&batch->arena);
+	free(batch);
+}
+
+static int dirreader_open(struct dirreader *reader, const char *path, bool defer)
+{
+	reader->fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if(reader->fd < 0)
+		return errno;
+
+	reader->buffer = malloc(DIRLOADER_GETDENTS_BUFFER_SIZE);
+	if(reader->buffer == NULL) {
+		close(reader->fd);
+		return ENOMEM;
+	}
+
+	reader->defer = defer;
+	reader->eof = false;
+	reader->length = 0;
+	reader->offset = 0;
+	return 0;
+}
+
+static void dirreader_close(struct dirreader *reader)
+{
+	free(reader->buffer);
+	if(reader->fd >= 0)
+		close(reader->fd);
+}
+
+/* Reads up to limit entries with large getdents64 calls. The buffer is kept
+ * between the calls, so that the next batch continues, where the last one
+ * stopped. Entries, for which the file type alone is enough, end up in
+ * deferred, all others in needstat. A directory, that cannot be read any
+ * further, is an error, not its end. */
+static int dirreader_read_entries(struct dirreader *reader, struct arena *arena, struct list *deferred, struct list *needstat, size_t limit)
+{
+	size_t count = 0;
+
+	while(count < limit) {
+		if(reader->offset >= reader->length) {
+			long length = syscall(SYS_getdents64, reader->fd, reader->buffer, DIRLOADER_GETDENTS_BUFFER_SIZE);
+			if(length < 0 && errno == EINTR)
+				continue;
+			if(length < 0)
+				return errno;
+			if(length == 0) {
+				reader->eof = true;
+				break;
+			}
+			reader->length = length;
+			reader->offset = 0;
+		}
+
+		struct linux_dirent64 *entry = (struct linux_dirent64 *)(reader->buffer + reader->offset);
+
+		if(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+			reader->offset += entry->d_reclen;
+			continue;
+		}
+
+		struct filedata *filedata;
+		if(filedata_arena_new(arena, &filedata, entry->d_name) != 0)
+			return ENOMEM;
+		filedata->mode = mode_from_dirent_type(entry->d_type);
+
+		struct list *list = (reader->defer && filedata->mode != 0) ? deferred : needstat;
+		if(!list_append(list, filedata)) {
+			filedata_arena_delete(arena, filedata);
+			return ENOMEM;
+		}
+		reader->offset += entry->d_reclen;
+		count++;
+	}
+	return 0;
+}
+
+static int dirreader_read_batch(struct dirreader *reader, struct statpool *statpool, struct arena *arena, size_t limit, struct list **batch)
+{
+	int ret = ENOMEM;
+
+	/* first collect the names, so that the expensive part, the stat
+	 * calls, can be batched or distributed over several threads */
+	struct list *deferred = list_new(0);
+	if(deferred == NULL)
+		goto err_newdeferred;
+
+	struct list *needstat = list_new(0);
+	if(needstat == NULL)
+		goto err_newneedstat;
+
+	ret = dirreader_read_entries(reader, arena, deferred, needstat, limit);
+	if(ret != 0)
+		goto err_read;
+
+	ret = statpool_stat_list(statpool, reader->fd, needstat, arena);
+	if(ret != 0)
+		goto err_read;
+
+	ret = ENOMEM;
+	for(size_t i = list_length(needstat); i > 0; i--) {
+		if(!list_append(deferred, list_get_item(needstat, i - 1)))
+			goto err_read;
+		list_remove(needstat, i - 1);
+	}
+
+	list_delete(needstat, NULL);
+	*batch = deferred;
+	return 0;
+
+err_read:
+	entries_delete(needstat, arena);
+err_newneedstat:
+	entries_delete(deferred, arena);
+err_newdeferred:
+	return ret;
+}
+
+/* Loads the whole directory in the calling thread. On success, the caller
+ * owns the returned directory file descriptor and the entries, which are
+ * allocated from arena. If io_uring turns out to be unusable,
+ * options->statpool is switched to threads. */
+int dirloader_load(const char *path, struct dirloader_options *options, int *dirfd, struct list **entries, struct arena *arena)
+{
+	struct dirreader reader;
+
+	int ret = dirreader_open(&reader, path, options->defer);
+	if(ret != 0)
+		return ret;
+
+	ret = dirreader_read_batch(&reader, &options->statpool, arena, SIZE_MAX, entries);
+	if(ret == 0) {
+		*dirfd = reader.fd;
+		reader.fd = -1;
+	}
+	dirreader_close(&reader);
+	return ret;
+}
+
+static void dirloader_job_release(struct dirloader_job *job)
+{
+	pthread_mutex_lock(&job->mutex);
+	unsigned int refs = --job->refs;
+	pthread_mutex_unlock(&job->mutex);
+
+	if(refs > 0)
+		return;
+
+	if(job->dirfd >= 0)
+		close(job->dirfd);
+	list_delete(job->batches, batch_delete);
+	close(job->eventfd);
+	free(job->path);
+	pthread_mutex_destroy(&job->mutex);
+	free(job);
+}
+
+static void dirloader_job_signal(struct dirloader_job *job)
+{
+	uint64_t value = 1;
+
+	/* can only fail, if the counter overflows, which means, that the
+	 * reader is woken up anyway */
+	if(write(job->eventfd, &value, sizeof(value)) < 0)
+		return;
+}
+
+static void *dirloader_worker(void *data)
+{
+	struct dirloader_job *job = data;
+	struct dirreader reader;
+
+	int ret = dirreader_open(&reader, job->path, job->options.defer);
+	if(ret != 0)
+		goto out;
+
+	/* the model gets its own descriptor, so that it does not matter, who
+	 * closes first */
+	int dirfd = fcntl(reader.fd, F_DUPFD_CLOEXEC, 0);
+	if(dirfd < 0) {
+		ret = errno;
+		goto out_close;
+	}
+	pthread_mutex_lock(&job->mutex);
+	job->dirfd = dirfd;
+	pthread_mutex_unlock(&job->mutex);
+
+	size_t limit = job->options.first_batch_size ? job->options.first_batch_size : SIZE_MAX;
+	while(!reader.eof && !atomic_load(&job->cancelled)) {
+		struct dirloader_batch *batch = malloc(sizeof(*batch));
+		if(batch == NULL) {
+			ret = ENOMEM;
+			break;
+		}
+		arena_init(&batch->arena);
+
+		ret = dirreader_read_batch(&reader, &job->options.statpool, &batch->arena, limit, &batch->entries);
+		if(ret != 0) {
+			arena_destroy(&batch->arena);
+			free(batch);
+			break;
+		}
+
+		pthread_mutex_lock(&job->mutex);
+		bool appended = list_append(job->batches, batch);
+		pthread_mutex_unlock(&job->mutex);
+		if(!appended) {
+			batch_delete(batch);
+			ret = ENOMEM;
+			break;
+		}
+		dirloader_job_signal(job);
+
+		if(limit < DIRLOADER_MAX_BATCH_SIZE)
+			limit *= 2;
+	}
+
+out_close:
+	dirreader_close(&reader);
+out:
+	pthread_mutex_lock(&job->mutex);
+	job->finished = true;
+	job->error = ret;
+	pthread_mutex_unlock(&job->mutex);
+	dirloader_job_signal(job);
+
+	dirloader_job_release(job);
+	return NULL;
+}
+
+/* Starts loading the directory in a background thread, any load still in
+ * progress is cancelled. The loader's eventfd becomes readable, whenever
+ * there is something to take. */
+bool dirloader_start(struct dirloader *loader, const char *path, const struct dirloader_options *options)
+{
+	dirloader_cancel(loader);
+
+	if(loader->eventfd < 0)
+		return false;
+
+	struct dirloader_job *job = malloc(sizeof(*job));
+	if(job == NULL)
+		goto err_job;
+
+	job->path = strdup(path);
+	if(job->path == NULL)
+		goto err_path;
+
+	job->batches = list_new(0);
+	if(job->batches == NULL)
+		goto err_batches;
+
+	/* a worker, that outlives the loader, must not write to a reused
+	 * descriptor */
+	job->eventfd = fcntl(loader->eventfd, F_DUPFD_CLOEXEC, 0);
+	if(job->eventfd < 0)
+		goto err_eventfd;
+
+	if(pthread_mutex_init(&job->mutex, NULL) != 0)
+		goto err_mutex;
+
+	job->refs = 2;
+	atomic_init(&job->cancelled, false);
+	job->options = *options;
+	job->dirfd = -1;
+	job->finished = false;
+	job->error = 0;
+
+	pthread_attr_t attr;
+	if(pthread_attr_init(&attr) != 0)
+		goto err_attr;
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+	pthread_t thread;
+	if(pthread_create(&thread, &attr, dirloader_worker, job) != 0)
+		goto err_thread;
+	pthread_attr_destroy(&attr);
+
+	loader->job = job;
+	return true;
+
+err_thread:
+	pthread_attr_destroy(&attr);
+err_attr:
+	pthread_mutex_destroy(&job->mutex);
+err_mutex:
+	close(job->eventfd);
+err_eventfd:
+	list_delete(job->batches, NULL);
+err_batches:
+	free(job->path);
+err_path:
+	free(job);
+err_job:
+	return false;
+}
+
+/* Takes the next loaded batch, its memory is moved into arena. The directory
+ * file descriptor is handed over once, together with or before the first
+ * batch or the error, that ended the reading, otherwise *dirfd is -1, so an
+ * error without a descriptor means, that the directory could not be opened.
+ * Returns EAGAIN, if the worker is not done
+ * yet, 0 with *entries set to NULL, when loading is complete, or the error,
+ * that ended the loading. Once the loading ended, statpool is switched to
+ * threads, if the worker found io_uring to be unusable. */
+int dirloader_take(struct dirloader *loader, int *dirfd, struct list **entries, struct arena *arena, struct statpool *statpool)
+{
+	struct dirloader_job *job = loader->job;
+	struct dirloader_batch *batch = NULL;
+	uint64_t value;
+	int ret;
+
+	*dirfd = -1;
+	*entries = NULL;
+	if(job == NULL)
+		return 0;
+
+	/* reset the counter, batches, that arrive later, signal again */
+	if(read(loader->eventfd, &value, sizeof(value)) < 0)
+		value = 0;
+
+	pthread_mutex_lock(&job->mutex);
+	*dirfd = job->dirfd;
+	job->dirfd = -1;
+
+	bool finished = false;
+	if(list_length(job->batches) > 0) {
+		batch = list_get_item(job->batches, 0);
+		list_remove(job->batches, 0);
+		ret = 0;
+	} else if(job->finished) {
+		finished = true;
+		ret = job->error;
+		if(!job->options.statpool.use_io_uring)
+			statpool->use_io_uring = false;
+	} else {
+		ret = EAGAIN;
+	}
+	pthread_mutex_unlock(&job->mutex);
+
+	if(batch) {
+		arena_merge(arena, &batch->arena);
+		*entries = batch->entries;
+		free(batch);
+	}
+
+	if(finished) {
+		dirloader_job_release(job);
+		loader->job = NULL;
+	}
+	return ret;
+}
+
+void dirloader_cancel(struct dirloader *loader)
+{
+	struct dirloader_job *job = loader->job;
+	if(job == NULL)
+		return;
+
+	atomic_store(&job->cancelled, true);
+	dirloader_job_release(job);
+	loader->job = NULL;
+}
+
+bool dirloader_isrunning(struct dirloader *loader)
+{
+	return loader->job != NULL;
+}
+
+/* Without an eventfd, dirloader_start always fails and the caller has to
+ * load synchronously. */
+void dirloader_init(struct dirloader *loader)
+{
+	loader->eventfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	loader->job = NULL;
+}
+
+void dirloader_destroy(struct dirloader *loader)
+{
+	dirloader_cancel(loader);
+	if(loader->eventfd >= 0)
+		close(loader->eventfd);
+}
@@ -0,0 +1,37 @@
+/* See LICENSE file for copyright and license details. */
+#ifndef DIRLOADER_H
+#define DIRLOADER_H
+
+#include "statpool.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct arena;
+struct list;
+struct dirloader_job;
+
+struct dirloader_options {
+	/* entries, whose type is known from the directory entry alone, are
+	 * not stat'ed, but marked as pending */
+	bool defer;
+	/* the following batches double in size, 0 loads everything in one
+	 * batch */
+	size_t first_batch_size;
+	struct statpool statpool;
+};
+
+struct dirloader {
+	int eventfd;
+	struct dirloader_job *job;
+};
+
+int dirloader_load(const char *path, struct dirloader_options *options, int *dirfd, struct list **entries, struct arena *arena) __attribute__((warn_unused_result));
+bool dirloader_start(struct dirloader *loader, const char *path, const struct dirloader_options *options) __attribute__((warn_unused_result));
+int dirloader_take(struct dirloader *loader, int *dirfd, struct list **entries, struct arena *arena, struct statpool *statpool);
+void dirloader_cancel(struct dirloader *loader);
+bool dirloader_isrunning(struct dirloader *loader);
+void dirloader_init(struct dirloader *loader);
+void dirloader_destroy(struct dirloader *loader);
+
+#endif
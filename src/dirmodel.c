@@ -2,14 +2,56 @@
 #include "dirmodel.h"
 
 #include "filedata.h"
+#include "hashset.h"
 #include "listmodel_impl.h"
 #include "list.h"
+#include "matcher.h"
+#include "namequeue.h"
+#include "ostree.h"
+#include "radixsort.h"
 #include "util.h"
 
+#include <ctype.h>
 #include <errno.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* when loading progressively, the first batch should fill a screen quickly,
+ * the following ones grow, so that the merges do not add up */
+#define DIRMODEL_FIRST_BATCH_SIZE 2048
+
+/* by default, a directory of a million entries can keep two other orders */
+#define DIRMODEL_SORTCACHE_LIMIT (32 * 1024 * 1024)
+/* rough memory needed per entry in a sorted list */
+#define SORTCACHE_ENTRY_SIZE (2 * sizeof(void *))
+
+/* below one new entry per this many shown ones, inserting the new entries
+ * one by one is cheaper than merging them into a new sorted list */
+#define MERGE_MIN_RATIO 16
+
+/* names, that only differ from a typed prefix in case or punctuation, can be
+ * sorted before the first one starting with it, so this many are looked at */
+#define PREFIX_SCAN_LIMIT 64
+
+/* the forms of a typed prefix, that are searched for in name order */
+enum prefix_case_form {
+	PREFIX_AS_TYPED,
+	PREFIX_LOWER,
+	PREFIX_UPPER,
+	PREFIX_CAPITALIZED,
+	PREFIX_CASE_FORMS
+};
+
+/* a file, that keeps changing, is stat'ed at most once per interval, which
+ * grows from the minimum to the maximum as long as the changes go on, and is
+ * forgotten after a quiet time, all in milliseconds */
+#define RESTAT_MIN_INTERVAL 100
+#define RESTAT_MAX_INTERVAL 1000
+#define RESTAT_QUIET_TIME (2 * RESTAT_MAX_INTERVAL)
 
 static int (*dirmodel_comparision_functions[])(const void *, const void *) = {
 	[DIRMODEL_FILENAME] = filedata_listcompare_directory_filename,
@@ -20,13 +62,21 @@ static int (*dirmodel_comparision_functions[])(const void *, const void *) = {
 	[DIRMODEL_MTIME_DESCENDING] = filedata_listcompare_directory_mtime_filename_descending,
 };
 
-static void dirmodel_update_marked_stats(struct dirmodel *model, struct filedata *oldfiledata, struct filedata *newfiledata)
+/* sort modes, whose order is defined by an integer key and a name */
+static uint64_t (*dirmodel_sortkey_functions[])(const struct filedata *) = {
+	[DIRMODEL_SIZE] = filedata_sortkey_size_filename,
+	[DIRMODEL_SIZE_DESCENDING] = filedata_sortkey_size_filename_descending,
+	[DIRMODEL_MTIME] = filedata_sortkey_mtime_filename,
+	[DIRMODEL_MTIME_DESCENDING] = filedata_sortkey_mtime_filename_descending,
+};
+
+static void dirmodel_update_marked_stats(struct dirmodel *model, const struct filedata *oldfiledata, const struct filedata *newfiledata)
 {
 	if(oldfiledata) {
 		if(oldfiledata->is_link) {
 			model->marked_stats.size -= oldfiledata->link_size;
 		} else {
-			model->marked_stats.size -= oldfiledata->stat.st_size;
+			model->marked_stats.size -= oldfiledata->size;
 		}
 		model->marked_stats.count--;
 	}
@@ -34,44 +84,202 @@ static void dirmodel_update_marked_stats(struct dirmodel *model, struct filedata
 		if(newfiledata->is_link) {
 			model->marked_stats.size += newfiledata->link_size;
 		} else {
-			model->marked_stats.size += newfiledata->stat.st_size;
+			model->marked_stats.size += newfiledata->size;
 		}
 		model->marked_stats.count++;
 	}
 }
 
-static void dirmodel_update_dirsize(struct dirmodel *model, struct filedata *oldfiledata, struct filedata *newfiledata)
+static void dirmodel_update_dirsize(struct dirmodel *model, const struct filedata *oldfiledata, const struct filedata *newfiledata)
 {
 	if(oldfiledata) {
 		if(oldfiledata->is_link) {
 			model->dirsize -= oldfiledata->link_size;
 		} else {
-			model->dirsize -= oldfiledata->stat.st_size;
+			model->dirsize -= oldfiledata->size;
 		}
 	}
 	if(newfiledata) {
 		if(newfiledata->is_link) {
 			model->dirsize += newfiledata->link_size;
 		} else {
-			model->dirsize += newfiledata->stat.st_size;
+			model->dirsize += newfiledata->size;
 		}
 	}
 }
 
+/* Applies the stat data of a pending entry, that was just fetched. type is
+ * the file type as it was known before. */
+static void resolve_entry(struct dirmodel *model, struct filedata *filedata, mode_t type, bool vanished)
+{
+	if(vanished) {
+		/* the file vanished, inotify will tell us soon */
+		filedata->is_stat_pending = false;
+		return;
+	}
+
+	/* the file was replaced by one of another type after reading the
+	 * directory, keep the old type, so that the sort order stays intact,
+	 * and let the next flush sort in the new file */
+	if((filedata->mode & S_IFMT) != type) {
+		filedata->mode = (filedata->mode & ~S_IFMT) | type;
+		(void)dirmodel_notify_file_added_or_changed(model, filedata->filename);
+	}
+}
+
+/* Completes the resolution of a pending entry, that is shown. */
+static void dirmodel_resolved(struct dirmodel *model, struct filedata *filedata, mode_t type, bool vanished)
+{
+	model->pending_count--;
+	resolve_entry(model, filedata, type, vanished);
+	if(!vanished)
+		dirmodel_update_dirsize(model, NULL, filedata);
+}
+
+/* Entries loaded in deferred mode only know their name and file type, the
+ * rest of the stat data is fetched here, when somebody needs it. */
+static void dirmodel_resolve(struct dirmodel *model, struct filedata *filedata)
+{
+	if(!filedata->is_stat_pending)
+		return;
+
+	mode_t type = filedata->mode & S_IFMT;
+	bool vanished = filedata_stat(filedata, model->dir_fd) != 0;
+	dirmodel_resolved(model, filedata, type, vanished);
+}
+
+/* Sorting by size or mtime needs the stat data of all entries, so those,
+ * that were loaded deferred, are resolved in one go, before they are sorted.
+ * Unlike dirmodel_resolved, the counters are left to the caller. */
+static void resolve_entries(struct dirmodel *model, struct list *entries)
+{
+	size_t length = list_length(entries);
+	mode_t *types = NULL;
+	bool *vanished = NULL;
+
+	struct list *pending = list_new(0);
+	if(pending == NULL)
+		goto one_by_one;
+	for(size_t i = 0; i < length; i++) {
+		struct filedata *filedata = list_get_item(entries, i);
+		if(filedata->is_stat_pending && !list_append(pending, filedata))
+			goto one_by_one;
+	}
+
+	size_t count = list_length(pending);
+	if(count == 0)
+		goto out;
+	types = malloc(count * sizeof(types[0]));
+	vanished = malloc(count * sizeof(vanished[0]));
+	if(types == NULL || vanished == NULL)
+		goto one_by_one;
+
+	for(size_t i = 0; i < count; i++) {
+		struct filedata *filedata = list_get_item(pending, i);
+		types[i] = filedata->mode & S_IFMT;
+	}
+
+	statpool_stat_entries(&model->statpool, model->dir_fd, pending, vanished);
+
+	for(size_t i = 0; i < count; i++)
+		resolve_entry(model, list_get_item(pending, i), types[i], vanished[i]);
+	goto out;
+
+one_by_one:
+	for(size_t i = 0; i < length; i++) {
+		struct filedata *filedata = list_get_item(entries, i);
+		if(filedata->is_stat_pending) {
+			mode_t type = filedata->mode & S_IFMT;
+			bool vanished = filedata_stat(filedata, model->dir_fd) != 0;
+			resolve_entry(model, filedata, type, vanished);
+		}
+	}
+out:
+	free(vanished);
+	free(types);
+	list_delete(pending, NULL);
+}
+
+/* Resolves all pending entries, that are about to be shown, in one batch.
+ * This is only an optimization, if memory is short, the entries get resolved
+ * one by one, when they are rendered. */
+static void dirmodel_prefetch(struct listmodel *listmodel, size_t index, size_t count)
+{
+	struct dirmodel *model = container_of(listmodel, struct dirmodel, listmodel);
+	struct ostree_cursor cursor;
+
+	model->shown_first = index;
+	model->shown_count = count;
+	if(model->pending_count == 0)
+		return;
+
+	struct list *batch = list_new(count);
+	if(batch == NULL)
+		return;
+
+	struct filedata *filedata = ostree_seek(model->sortedlist, index, &cursor);
+	for(size_t i = 0; i < count; i++, filedata = ostree_next(&cursor)) {
+		/* directories are rendered without their size */
+		if(filedata->is_stat_pending && !S_ISDIR(filedata->mode))
+			if(!list_append(batch, filedata))
+				goto err_batch;
+	}
+
+	size_t length = list_length(batch);
+	if(length == 0)
+		goto err_batch;
+
+	mode_t *types = malloc(length * sizeof(types[0]));
+	if(types == NULL)
+		goto err_batch;
+	bool *vanished = malloc(length * sizeof(vanished[0]));
+	if(vanished == NULL)
+		goto err_types;
+
+	for(size_t i = 0; i < length; i++) {
+		struct filedata *filedata = list_get_item(batch, i);
+		types[i] = filedata->mode & S_IFMT;
+	}
+
+	statpool_stat_entries(&model->statpool, model->dir_fd, batch, vanished);
+
+	for(size_t i = 0; i < length; i++)
+		dirmodel_resolved(model, list_get_item(batch, i), types[i], vanished[i]);
+
+	free(vanished);
+err_types:
+	free(types);
+err_batch:
+	list_delete(batch, NULL);
+}
+
+/* Keeps the range, that was prefetched last, on the same entries, when some
+ * before it are added or removed, like the views keep their cursor. The next
+ * prefetch tells the exact range again. */
+static void shift_shown_range(struct dirmodel *model, size_t added, size_t removed)
+{
+	if(model->shown_count == SIZE_MAX)
+		return;
+	model->shown_first += added;
+	model->shown_first -= removed < model->shown_first ? removed : model->shown_first;
+}
+
 size_t dirmodel_count(struct listmodel *listmodel)
 {
 	struct dirmodel *model = container_of(listmodel, struct dirmodel, listmodel);
-	struct list *list = model->list;
-	if(list == NULL)
+	if(model->sortedlist == NULL)
 		return 0;
-	return list_length(list);
+	return ostree_length(model->sortedlist);
 }
 
 static size_t dirmodel_render(struct listmodel *listmodel, wchar_t *buffer, size_t len, size_t width, size_t index)
 {
 	struct dirmodel *model = container_of(listmodel, struct dirmodel, listmodel);;
-	struct list *list = model->sortedlist;
-	struct filedata *filedata = list_get_item(list, index);
+	struct filedata *filedata = ostree_get_item(model->sortedlist, index);
+
+	/* directories are rendered without their size */
+	if(!S_ISDIR(filedata->mode))
+		dirmodel_resolve(model, filedata);
 
 	return filedata_format_list_line(filedata, buffer, len, width);
 }
@@ -79,13 +287,13 @@ static size_t dirmodel_render(struct listmodel *listmodel, wchar_t *buffer, size
 static void dirmodel_setmark(struct listmodel *listmodel, size_t index, bool mark)
 {
 	struct dirmodel *model = container_of(listmodel, struct dirmodel, listmodel);;
-	struct list *list = model->sortedlist;
-	struct filedata *filedata = list_get_item(list, index);
+	struct filedata *filedata = ostree_get_item(model->sortedlist, index);
 
 	if(filedata->is_marked == mark)
 		return;
 
 	if(mark) {
+		dirmodel_resolve(model, filedata);
 		dirmodel_update_marked_stats(model, NULL, filedata);
 	} else {
 		dirmodel_update_marked_stats(model, filedata, NULL);
@@ -97,24 +305,20 @@ static void dirmodel_setmark(struct listmodel *listmodel, size_t index, bool mar
 static bool dirmodel_ismarked(struct listmodel *listmodel, size_t index)
 {
 	struct dirmodel *model = container_of(listmodel, struct dirmodel, listmodel);;
-	struct list *list = model->sortedlist;
-	struct filedata *filedata = list_get_item(list, index);
+	struct filedata *filedata = ostree_get_item(model->sortedlist, index);
 	return filedata->is_marked;
 }
 
 int dirmodel_getmarkedfilenames(struct dirmodel *model, const struct list **markedlist_out)
 {
-	struct list *list = model->sortedlist;
+	struct ostree_cursor cursor;
 	struct list *markedlist = list_new(0);
 
 	if(markedlist == NULL)
 		return ENOMEM;
 
-	size_t length = list_length(list);
-
-	for(size_t i = 0; i < length; i++)
+	for(struct filedata *filedata = ostree_seek(model->sortedlist, 0, &cursor); filedata; filedata = ostree_next(&cursor))
 	{
-		struct filedata *filedata = list_get_item(list, i);
 		if(filedata->is_marked) {
 			char *filename = strdup(filedata->filename);
 			if(filename == NULL) {
@@ -142,76 +346,265 @@ struct marked_stats dirmodel_getmarkedstats(struct dirmodel *model)
 	return model->marked_stats;
 }
 
-bool dirmodel_get_internal_index(struct dirmodel *model, const char *filename, size_t *internal_index, size_t *index)
+static const char *filedata_key(const void *item)
+{
+	const struct filedata *filedata = item;
+	return filedata->filename;
+}
+
+static void sortcache_clear(struct dirmodel *model)
 {
-	struct filedata filedata;
+	for(size_t mode = 0; mode < DIRMODEL_SORT_MODES; mode++) {
+		ostree_delete(model->sortcache[mode], NULL);
+		model->sortcache[mode] = NULL;
+	}
+}
 
-	filedata.filename = filename;
+/* Keeps the sorted list of a sort mode, that is left, for later. If the limit
+ * does not allow another list, the least recently used ones are dropped. */
+static void sortcache_store(struct dirmodel *model, enum dirmodel_sort_mode mode, struct ostree *tree)
+{
+	size_t size = ostree_length(tree) * SORTCACHE_ENTRY_SIZE;
+	size_t allowed = size > 0 ? model->sortcache_limit / size : DIRMODEL_SORT_MODES;
+	size_t count = 0;
 
-	if(!list_find_item_or_insertpoint(model->list, filedata_listcompare_filename, &filedata, internal_index))
-		return false;
+	if(allowed == 0) {
+		ostree_delete(tree, NULL);
+		return;
+	}
 
-	struct filedata *internal_filedata = list_get_item(model->list, *internal_index);
-	if(!list_find_item_or_insertpoint(model->sortedlist, model->sort_compare, internal_filedata, index))
-		return false;
-	return true;
+	for(size_t i = 0; i < DIRMODEL_SORT_MODES; i++)
+		if(model->sortcache[i])
+			count++;
+	for(; count >= allowed; count--) {
+		size_t oldest = DIRMODEL_SORT_MODES;
+		for(size_t i = 0; i < DIRMODEL_SORT_MODES; i++)
+			if(model->sortcache[i] && (oldest == DIRMODEL_SORT_MODES || model->sortcache_used[i] < model->sortcache_used[oldest]))
+				oldest = i;
+		ostree_delete(model->sortcache[oldest], NULL);
+		model->sortcache[oldest] = NULL;
+	}
+
+	model->sortcache[mode] = tree;
+	model->sortcache_used[mode] = ++model->sortcache_clock;
+}
+
+/* The cached lists are only an optimization, so a list, that cannot be
+ * updated, because memory is short, is simply dropped. */
+static void sortcache_insert(struct dirmodel *model, struct filedata *filedata)
+{
+	size_t index;
+
+	for(size_t mode = 0; mode < DIRMODEL_SORT_MODES; mode++) {
+		struct ostree *tree = model->sortcache[mode];
+		if(tree == NULL)
+			continue;
+		ostree_find_item_or_insertpoint(tree, dirmodel_comparision_functions[mode], filedata, &index);
+		if(!ostree_insert(tree, index, filedata)) {
+			ostree_delete(tree, NULL);
+			model->sortcache[mode] = NULL;
+		}
+	}
+}
+
+static void sortcache_remove(struct dirmodel *model, struct filedata *filedata)
+{
+	size_t index;
+
+	for(size_t mode = 0; mode < DIRMODEL_SORT_MODES; mode++) {
+		struct ostree *tree = model->sortcache[mode];
+		if(tree == NULL)
+			continue;
+		if(ostree_find_item_or_insertpoint(tree, dirmodel_comparision_functions[mode], filedata, &index))
+			ostree_remove(tree, index);
+	}
+}
+
+/* Looks the entry up by name and finds its position in the sorted list. */
+static struct filedata *dirmodel_find(struct dirmodel *model, const char *filename, size_t *index)
+{
+	struct filedata *filedata = hashset_get(&model->names, filename);
+	if(filedata == NULL || filedata->is_hidden)
+		return NULL;
+
+	if(!ostree_find_item_or_insertpoint(model->sortedlist, model->sort_compare, filedata, index))
+		return NULL;
+	return filedata;
 }
 
 bool dirmodel_get_index(struct dirmodel *model, const char *filename, size_t *index)
 {
-	size_t internal_index;
-	return dirmodel_get_internal_index(model, filename, &internal_index, index);
+	return dirmodel_find(model, filename, index) != NULL;
 }
 
+/* Searches from the entry after start_index in direction and wraps around at
+ * the end of the list, so that start_index itself is checked last. The
+ * compiled pattern is kept for repeated searches with the same one. */
 size_t dirmodel_regex_getnext(struct dirmodel *model, const char *regex, size_t start_index, int direction)
 {
-	struct list *list = model->sortedlist;
-	regex_t cregex;
-	size_t result = start_index;
-
-	int ret = regcomp(&cregex, regex, REG_EXTENDED | REG_ICASE | REG_NOSUB);
-	if(ret != 0)
+	struct ostree *list = model->sortedlist;
+	struct ostree_cursor cursor;
+	size_t length = list ? ostree_length(list) : 0;
+
+	if(model->search.pattern == NULL || strcmp(model->search.pattern, regex) != 0) {
+		matcher_destroy(&model->search);
+		if(matcher_init(&model->search, regex) != 0)
+			return start_index;
+	}
+	if(length == 0)
 		return start_index;
 
-	if(direction > 0 && start_index < SIZE_MAX) {
-		size_t length = list_length(list);
-		for(size_t i = start_index + 1; i < length; i++) {
-			struct filedata *filedata = list_get_item(list, i);
-			if(regexec(&cregex, filedata->filename, 0, NULL, 0) == 0) {
-				result = i;
-				break;
-			}
+	if(direction > 0) {
+		size_t start = start_index < length - 1 ? start_index + 1 : 0;
+		struct filedata *filedata = ostree_seek(list, start, &cursor);
+		for(size_t i = 0; i < length; i++) {
+			if(matcher_match(&model->search, filedata->filename))
+				return start + i < length ? start + i : start + i - length;
+			filedata = ostree_next(&cursor);
+			if(filedata == NULL)
+				filedata = ostree_seek(list, 0, &cursor);
 		}
-	} else if(direction < 0 && start_index > 0) {
-		for(size_t i = start_index - 1; i > 0; i--) {
-			struct filedata *filedata = list_get_item(list, i);
-			if(regexec(&cregex, filedata->filename, 0, NULL, 0) == 0) {
-				result = i;
-				break;
-			}
+	} else if(direction < 0) {
+		size_t index = start_index < length ? start_index : length;
+		for(size_t i = 0; i < length; i++) {
+			index = index > 0 ? index - 1 : length - 1;
+			struct filedata *filedata = ostree_get_item(list, index);
+			if(matcher_match(&model->search, filedata->filename))
+				return index;
 		}
 	}
+	return start_index;
+}
 
-	regfree(&cregex);
-	return result;
+static bool has_prefix(const struct filedata *filedata, const char *prefix, size_t length)
+{
+	return strncasecmp(filedata->filename, prefix, length) == 0;
 }
 
-void dirmodel_regex_setmark(struct dirmodel *model, const char *regex, bool mark)
+static bool find_prefix_linear(struct ostree *list, const char *prefix, size_t *index)
 {
-	struct list *list = model->sortedlist;
-	regex_t cregex;
+	struct ostree_cursor cursor;
+	size_t length = strlen(prefix);
+
+	struct filedata *filedata = ostree_seek(list, 0, &cursor);
+	for(size_t i = 0; filedata; i++, filedata = ostree_next(&cursor)) {
+		if(has_prefix(filedata, prefix, length)) {
+			*index = i;
+			return true;
+		}
+	}
+	return false;
+}
 
-	int ret = regcomp(&cregex, regex, REG_EXTENDED | REG_ICASE | REG_NOSUB);
-	if(ret != 0)
-		return;
+/* Looks at the entries from the point, where probe would be inserted, up to
+ * the end of the directories or the other files, which probe belongs to. */
+static bool find_prefix_behind(struct dirmodel *model, const struct filedata *probe, size_t *index)
+{
+	struct ostree_cursor cursor;
+	size_t start, length = strlen(probe->filename);
+
+	ostree_find_item_or_insertpoint(model->sortedlist, model->sort_compare, probe, &start);
+	struct filedata *filedata = ostree_seek(model->sortedlist, start, &cursor);
+	for(size_t i = 0; filedata && i < PREFIX_SCAN_LIMIT; i++, filedata = ostree_next(&cursor)) {
+		if(S_ISDIR(filedata->mode) != S_ISDIR(probe->mode))
+			break;
+		if(has_prefix(filedata, probe->filename, length)) {
+			*index = start + i;
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Looks behind the place, where prefix would be sorted in, first among the
+ * directories and then among the other files. */
+static bool find_prefix_near(struct dirmodel *model, const char *prefix, size_t *index)
+{
+	struct filedata *probe;
+	bool found;
 
-	size_t length = list_length(list);
+	if(filedata_new(&probe, prefix) != 0)
+		return false;
 
-	for(size_t i = 0; i < length; i++) {
-		struct filedata *filedata = list_get_item(list, i);
-		if(regexec(&cregex, filedata->filename, 0, NULL, 0) == 0 &&
-		   filedata->is_marked != mark) {
+	probe->mode = S_IFDIR;
+	found = find_prefix_behind(model, probe, index);
+	if(!found) {
+		probe->mode = S_IFREG;
+		found = find_prefix_behind(model, probe, index);
+	}
+
+	filedata_delete(probe);
+	return found;
+}
+
+/* Writes prefix as typed, in lower case, in upper case or capitalized. */
+static void prefix_case_form(char *form, const char *prefix, int which)
+{
+	size_t i;
+
+	for(i = 0; prefix[i]; i++) {
+		unsigned char c = prefix[i];
+		if(which == PREFIX_LOWER || (which == PREFIX_CAPITALIZED && i > 0))
+			c = tolower(c);
+		else if(which == PREFIX_UPPER || which == PREFIX_CAPITALIZED)
+			c = toupper(c);
+		form[i] = c;
+	}
+	form[i] = '\0';
+}
+
+/* Finds an entry, whose name starts with prefix, ignoring case.
+ *
+ * In ascending name order, such names usually follow the point, where the
+ * prefix itself would be sorted in, so they are found with binary searches
+ * for the prefix as typed, in lower case, in upper case and capitalized, each
+ * followed by a look at the next PREFIX_SCAN_LIMIT entries. Of the entries
+ * found this way, the first in the list is returned. Names in other mixes of
+ * case can be sorted elsewhere, so they are only found, if they are sorted
+ * close by, and without memory for the searches, nothing is found.
+ *
+ * The other orders do not depend on the name, so there the entries are
+ * scanned from the top, which takes time linear in their number. */
+bool dirmodel_find_prefix(struct dirmodel *model, const char *prefix, size_t *index)
+{
+	size_t length = strlen(prefix);
+	char form[length + 1];
+	bool found = false;
+
+	if(model->sortedlist == NULL || ostree_length(model->sortedlist) == 0)
+		return false;
+	if(model->sorted_mode != DIRMODEL_FILENAME)
+		return find_prefix_linear(model->sortedlist, prefix, index);
+
+	for(int which = 0; which < PREFIX_CASE_FORMS; which++) {
+		size_t candidate;
+
+		prefix_case_form(form, prefix, which);
+		if(which != PREFIX_AS_TYPED && strcmp(form, prefix) == 0)
+			continue;
+		if(find_prefix_near(model, form, &candidate) && (!found || candidate < *index)) {
+			*index = candidate;
+			found = true;
+		}
+	}
+	return found;
+}
+
+/* Returns false, if the regex is invalid or there was not enough memory for
+ * it. */
+bool dirmodel_regex_setmark(struct dirmodel *model, const char *regex, bool mark)
+{
+	struct ostree_cursor cursor;
+	struct matcher matcher;
+
+	if(matcher_init(&matcher, regex) != 0)
+		return false;
+
+	struct filedata *filedata = ostree_seek(model->sortedlist, 0, &cursor);
+	for(size_t i = 0; filedata; i++, filedata = ostree_next(&cursor)) {
+		if(filedata->is_marked != mark && matcher_match(&matcher, filedata->filename)) {
 			if(mark) {
+				dirmodel_resolve(model, filedata);
 				dirmodel_update_marked_stats(model, NULL, filedata);
 			} else {
 				dirmodel_update_marked_stats(model, filedata, NULL);
@@ -221,290 +614,1211 @@ void dirmodel_regex_setmark(struct dirmodel *model, const char *regex, bool mark
 		}
 	}
 
-	regfree(&cregex);
+	matcher_destroy(&matcher);
+	return true;
 }
 
 bool dirmodel_setfilter(struct dirmodel *model, const char *regex)
 {
-	if(model->filter_active)
-		regfree(&model->filter);
+	struct matcher filter;
+	bool active = regex != NULL && matcher_init(&filter, regex) == 0;
 
-	if(regex == NULL) {
-		model->filter_active = false;
-	} else {
-		int ret = regcomp(&model->filter, regex, REG_EXTENDED | REG_ICASE | REG_NOSUB);
-		model->filter_active = (ret == 0);
-	}
+	/* the cached lists only hold the entries, that passed the old filter */
+	sortcache_clear(model);
+
+	if(model->filter.pattern != NULL)
+		model->filter_narrowed = model->filter_narrowed && active && matcher_narrows(&model->filter, &filter);
+	matcher_destroy(&model->filter);
+	if(active)
+		model->filter = filter;
 
-	return model->filter_active;
+	return active;
 }
 
-void dirmodel_set_sort_mode(struct dirmodel *model, enum dirmodel_sort_mode mode)
+const char *dirmodel_getfilter(struct dirmodel *model)
+{
+	return model->filter.pattern;
+}
+
+static bool dirmodel_filters_out(struct dirmodel *model, const char *filename)
 {
+	return model->filter.pattern != NULL && !matcher_match(&model->filter, filename);
+}
+
+/* Makes mode the order of the sorted list. */
+static void use_sort_mode(struct dirmodel *model, enum dirmodel_sort_mode mode)
+{
+	model->sorted_mode = mode;
 	model->sort_compare = dirmodel_comparision_functions[mode];
 }
 
-void dirmodel_notify_file_deleted(struct dirmodel *model, const char *filename)
+/* Once a directory is loaded, the new mode only takes effect with
+ * dirmodel_rearrange. */
+void dirmodel_set_sort_mode(struct dirmodel *model, enum dirmodel_sort_mode mode)
 {
-	struct list *list = model->list;
-	size_t index, internal_index;
+	model->sort_mode = mode;
+	if(model->sortedlist == NULL)
+		use_sort_mode(model, mode);
+}
 
-	bool found = dirmodel_get_internal_index(model, filename, &internal_index, &index);
-	if(found) {
-		struct filedata *filedata = list_get_item(list, internal_index);
-		if(filedata->is_marked) {
-			dirmodel_update_marked_stats(model, filedata, NULL);
-		}
+/* Sets how many bytes the sorted lists for other sort modes may take. A
+ * limit of 0 disables keeping them. */
+void dirmodel_set_sortcache_limit(struct dirmodel *model, size_t limit)
+{
+	model->sortcache_limit = limit;
+	sortcache_clear(model);
+}
+
+void dirmodel_set_load_mode(struct dirmodel *model, enum dirmodel_load_mode mode)
+{
+	model->load_mode = mode;
+}
+
+static bool sort_mode_needs_stat(enum dirmodel_sort_mode mode)
+{
+	return mode != DIRMODEL_FILENAME && mode != DIRMODEL_FILENAME_DESCENDING;
+}
+
+/* Drops the cached lists, in which an entry with changed stat data may be out
+ * of place, the orders by name stay valid. */
+static void sortcache_clear_stat_modes(struct dirmodel *model)
+{
+	for(size_t mode = 0; mode < DIRMODEL_SORT_MODES; mode++) {
+		if(!sort_mode_needs_stat(mode))
+			continue;
+		ostree_delete(model->sortcache[mode], NULL);
+		model->sortcache[mode] = NULL;
+	}
+}
+
+/* what happened last to a queued name */
+enum queued_event {
+	QUEUED_ADDED_OR_CHANGED,
+	QUEUED_DELETED,
+};
+
+/* Takes the counts of a shown entry, that is removed, off the model. */
+static void forget_entry(struct dirmodel *model, struct filedata *filedata)
+{
+	if(filedata->is_marked) {
+		dirmodel_update_marked_stats(model, filedata, NULL);
+	}
+	if(filedata->is_stat_pending)
+		model->pending_count--;
+	else
 		dirmodel_update_dirsize(model, filedata, NULL);
-		filedata_delete(filedata);
-		list_remove(list, internal_index);
-		list_remove(model->sortedlist, index);
+	sortcache_remove(model, filedata);
+}
+
+static void dirmodel_remove_file(struct dirmodel *model, struct filedata *filedata)
+{
+	size_t index;
+
+	if(dirmodel_find(model, filedata->filename, &index)) {
+		forget_entry(model, filedata);
+		ostree_remove(model->sortedlist, index);
+		shift_shown_range(model, 0, index < model->shown_first);
 		listmodel_notify_change(&model->listmodel, MODEL_REMOVE, 0, index);
 	}
+	hashset_remove(&model->names, filedata->filename);
+	filedata_arena_delete(&model->arena, filedata);
 }
 
-static int dirmodel_update_file(struct dirmodel *model, struct filedata *newfiledata, size_t internal_index)
+/* The entry is removed with the next flush, together with the others
+ * deleted meanwhile. Only if the name cannot be queued, it goes at once. */
+void dirmodel_notify_file_deleted(struct dirmodel *model, const char *filename)
+{
+	if(namequeue_add(&model->event_queue, filename, QUEUED_DELETED))
+		return;
+
+	struct filedata *filedata = hashset_get(&model->names, filename);
+	if(filedata != NULL)
+		dirmodel_remove_file(model, filedata);
+}
+
+/* Applies the stat data of newfiledata, a fresh entry for the same file, in
+ * place, so that the entry stays, where the names, the sorted list and the
+ * cached lists point to. */
+static int dirmodel_update_file(struct dirmodel *model, struct filedata *filedata, const struct filedata *newfiledata)
 {
-	struct filedata *oldfiledata = list_get_item(model->list, internal_index);
 	size_t newindex, oldindex;
 
-	newfiledata->is_marked = oldfiledata->is_marked;
-	if(newfiledata->is_marked) {
-		dirmodel_update_marked_stats(model, oldfiledata, newfiledata);
+	/* the filter only looks at the name, so the entry stays hidden */
+	if(filedata->is_hidden) {
+		filedata_copy_stat(filedata, newfiledata);
+		return 0;
 	}
-	dirmodel_update_dirsize(model, oldfiledata, newfiledata);
 
-	list_find_item_or_insertpoint(model->sortedlist, model->sort_compare, oldfiledata, &oldindex);
-	list_find_item_or_insertpoint(model->sortedlist, model->sort_compare, newfiledata, &newindex);
+	ostree_find_item_or_insertpoint(model->sortedlist, model->sort_compare, filedata, &oldindex);
+	ostree_find_item_or_insertpoint(model->sortedlist, model->sort_compare, newfiledata, &newindex);
 
-	if((newindex == oldindex) || (newindex == oldindex + 1)) {
-		list_set_item(model->sortedlist, oldindex, newfiledata);
-		listmodel_notify_change(&model->listmodel, MODEL_CHANGE, oldindex, oldindex);
-	} else {
+	bool moved = newindex != oldindex && newindex != oldindex + 1;
+	if(moved) {
 		if(oldindex < newindex)
 			newindex--;
-		list_move_item(model->sortedlist, oldindex, newindex);
+		if(!ostree_move_item(model->sortedlist, oldindex, newindex))
+			return ENOMEM;
+	}
+
+	if(filedata->is_stat_pending)
+		model->pending_count--;
+	if(filedata->is_marked) {
+		dirmodel_update_marked_stats(model, filedata, newfiledata);
+	}
+	dirmodel_update_dirsize(model, filedata->is_stat_pending ? NULL : filedata, newfiledata);
+
+	sortcache_remove(model, filedata);
+	filedata_copy_stat(filedata, newfiledata);
+	sortcache_insert(model, filedata);
+
+	if(moved) {
+		shift_shown_range(model, 0, oldindex < model->shown_first);
+		shift_shown_range(model, newindex <= model->shown_first, 0);
 		listmodel_notify_change(&model->listmodel, MODEL_CHANGE, newindex, oldindex);
+	} else {
+		listmodel_notify_change(&model->listmodel, MODEL_CHANGE, oldindex, oldindex);
 	}
-	list_set_item(model->list, internal_index, newfiledata);
-	filedata_delete(oldfiledata);
 
 	return 0;
 }
 
-static int dirmodel_add_file(struct dirmodel *model, struct filedata *filedata, size_t internal_index)
+int dirmodel_notify_file_added_or_changed(struct dirmodel *model, const char *filename)
 {
-	if(!list_insert(model->list, internal_index, filedata)) {
-		filedata_delete(filedata);
-		return ENOMEM;
+	return namequeue_add(&model->event_queue, filename, QUEUED_ADDED_OR_CHANGED) ? 0 : ENOMEM;
+}
+
+/* Deleted entries leave holes in the arena, that only names of the same size
+ * class can fill again. Once more is wasted than used, the entries are
+ * copied into a fresh arena in display order, which also gives scrolling
+ * and searching a sequential access pattern again. This is only an
+ * optimization, so it is silently skipped, if memory is short. */
+static void dirmodel_compact(struct dirmodel *model)
+{
+	size_t wasted = model->arena.capacity - model->arena.allocated;
+	if(wasted < ARENA_CHUNK_SIZE || wasted < model->arena.allocated)
+		return;
+
+	struct arena arena;
+	arena_init(&arena);
+
+	struct hashset names;
+	hashset_init(&names, filedata_key);
+
+	struct ostree_cursor cursor;
+	struct ostree *sortedlist = ostree_new();
+	if(sortedlist == NULL)
+		goto err_sortedlist;
+
+	for(struct filedata *old = ostree_seek(model->sortedlist, 0, &cursor); old; old = ostree_next(&cursor)) {
+		struct filedata *filedata;
+		if(filedata_arena_copy(&arena, &filedata, old) != 0)
+			goto err_copy;
+		if(!ostree_append(sortedlist, filedata))
+			goto err_copy;
+		if(!hashset_insert(&names, filedata))
+			goto err_copy;
+	}
+	size_t position = 0;
+	for(struct filedata *old; (old = hashset_next(&model->names, &position)); ) {
+		struct filedata *filedata;
+		if(!old->is_hidden)
+			continue;
+		if(filedata_arena_copy(&arena, &filedata, old) != 0)
+			goto err_copy;
+		if(!hashset_insert(&names, filedata))
+			goto err_copy;
 	}
 
-	size_t index;
-	list_find_item_or_insertpoint(model->sortedlist, model->sort_compare, filedata, &index);
+	/* the cached lists still point into the old arena */
+	sortcache_clear(model);
+	ostree_delete(model->sortedlist, NULL);
+	hashset_destroy(&model->names, NULL);
+	arena_destroy(&model->arena);
+	model->sortedlist = sortedlist;
+	model->names = names;
+	model->arena = arena;
+	model->generation++;
+	return;
+
+err_copy:
+	ostree_delete(sortedlist, NULL);
+err_sortedlist:
+	hashset_destroy(&names, NULL);
+	arena_destroy(&arena);
+}
 
-	if(!list_insert(model->sortedlist, index, filedata)) {
-		filedata_delete(filedata);
-		list_remove(model->list, internal_index);
-		return ENOMEM;
+const char *dirmodel_getfilename(struct dirmodel *model, size_t index)
+{
+	struct filedata *filedata = ostree_get_item(model->sortedlist, index);
+	return filedata->filename;
+}
+
+const struct filedata *dirmodel_getfiledata(struct dirmodel *model, size_t index)
+{
+	struct filedata *filedata = ostree_get_item(model->sortedlist, index);
+
+	dirmodel_resolve(model, filedata);
+	return filedata;
+}
+
+off_t dirmodel_getdirsize(struct dirmodel *model)
+{
+	return model->dirsize;
+}
+
+size_t dirmodel_getpendingcount(struct dirmodel *model)
+{
+	return model->pending_count;
+}
+
+bool dirmodel_isdir(struct dirmodel *model, size_t index)
+{
+	struct filedata *filedata = ostree_get_item(model->sortedlist, index);
+	return S_ISDIR(filedata->mode);
+}
+
+/* Drops all entries from the batch, that were already added or deleted
+ * through inotify, while the directory was still being read, and hides those,
+ * that do not pass the filter. */
+static void drop_unwanted_entries(struct dirmodel *model, struct list *batch)
+{
+	size_t batchlength = list_length(batch);
+	size_t kept = 0;
+
+	for(size_t j = 0; j < batchlength; j++) {
+		struct filedata *filedata = list_get_item(batch, j);
+
+		if(hashset_get(&model->names, filedata->filename) != NULL ||
+				namequeue_contains(&model->loading_deleted, filedata->filename)) {
+			filedata_arena_delete(&model->arena, filedata);
+		} else {
+			filedata->is_hidden = dirmodel_filters_out(model, filedata->filename);
+			list_set_item(batch, kept++, filedata);
+		}
 	}
-	dirmodel_update_dirsize(model, NULL, filedata);
-	listmodel_notify_change(&model->listmodel, MODEL_ADD, index, 0);
-	return 0;
+	for(size_t j = batchlength; j > kept; j--)
+		list_remove(batch, j - 1);
 }
 
-static int dirmodel_notify_file_added_or_changed_real(struct dirmodel *model, const char *filename)
+static int compare_radixsort_item_filename(const void *a, const void *b)
 {
-	struct filedata *filedata;
-	size_t internal_index;
+	const struct radixsort_item *item1 = a;
+	const struct radixsort_item *item2 = b;
 
-	if(model->filter_active && regexec(&model->filter, filename, 0, NULL, 0) != 0)
-		return 0;
+	return filedata_listcompare_directory_filename(&item1->item, &item2->item);
+}
 
-	int ret = filedata_new_from_file(&filedata, dirfd(model->dir), filename);
-	if(ret != 0)
-		return ret;
+/* For the size and mtime modes, the batch is radix sorted by the integer
+ * keys, so that only runs of equal keys are left to be sorted by name. If
+ * there is no memory for the keys, the comparator does all the work. */
+static void sort_batch(struct list *batch, enum dirmodel_sort_mode mode)
+{
+	uint64_t (*sortkey)(const struct filedata *) = dirmodel_sortkey_functions[mode];
+	size_t length = list_length(batch);
 
-	bool found = list_find_item_or_insertpoint(model->list, filedata_listcompare_filename, filedata, &internal_index);
-	if(found)
-		return dirmodel_update_file(model, filedata, internal_index);
-	else
-		return dirmodel_add_file(model, filedata, internal_index);
+	if(sortkey == NULL)
+		goto fallback;
 
-	return 0;
+	struct radixsort_item *items = malloc(length * sizeof(*items));
+	if(items == NULL)
+		goto fallback;
+
+	for(size_t i = 0; i < length; i++) {
+		items[i].item = list_get_item(batch, i);
+		items[i].key = sortkey(items[i].item);
+	}
+	if(radixsort(items, length) != 0) {
+		free(items);
+		goto fallback;
+	}
+
+	for(size_t i = 0, j; i < length; i = j) {
+		for(j = i + 1; j < length && items[j].key == items[i].key; j++)
+			;
+		if(j - i > 1)
+			qsort(&items[i], j - i, sizeof(items[0]), compare_radixsort_item_filename);
+	}
+	for(size_t i = 0; i < length; i++)
+		list_set_item(batch, i, items[i].item);
+
+	free(items);
+	return;
+
+fallback:
+	list_sort(batch, dirmodel_comparision_functions[mode]);
 }
 
-static int listcompare_strcmp(const void *a, const void *b)
+static bool batch_is_hidden(const struct list *batch, size_t index)
 {
-	char *string1 = *(char **)a;
-	char *string2 = *(char **)b;
+	const struct filedata *filedata = list_get_item(batch, index);
+	return filedata->is_hidden;
+}
 
-	return strcmp(string1, string2);
+/* Merges a sorted tree and the shown entries of a sorted list into a new tree
+ * in a single pass, instead of inserting the entries one by one. The index in
+ * tree, that each entry is merged in at, goes to insertpoints, if given. */
+static struct ostree *merge_sorted(const struct ostree *tree, const struct list *batch, int (*compare)(const void *, const void *),
+		size_t *insertpoints)
+{
+	struct ostree_cursor cursor;
+	size_t batchlength = list_length(batch);
+	size_t j = 0, taken = 0, added = 0;
+
+	struct ostree *merged = ostree_new();
+	if(merged == NULL)
+		return NULL;
+
+	void *a = ostree_seek(tree, 0, &cursor);
+	while(a || j < batchlength) {
+		void *item;
+		if(j < batchlength && batch_is_hidden(batch, j)) {
+			j++;
+			continue;
+		}
+		if(j == batchlength) {
+			item = a;
+		} else if(a == NULL) {
+			item = list_get_item(batch, j);
+		} else {
+			void *b = list_get_item(batch, j);
+			item = compare(&a, &b) <= 0 ? a : b;
+		}
+		if(item == a) {
+			a = ostree_next(&cursor);
+			taken++;
+		} else {
+			if(insertpoints)
+				insertpoints[added++] = taken;
+			j++;
+		}
+		if(!ostree_append(merged, item)) {
+			ostree_delete(merged, NULL);
+			return NULL;
+		}
+	}
+	return merged;
 }
 
-int dirmodel_notify_file_added_or_changed(struct dirmodel *model, const char *filename)
+/* Inserts the shown entries of a sorted list into a sorted tree one by one,
+ * which is cheaper than merging, if there are only a few of them. Like with
+ * merge_sorted, the indexes in the old tree go to insertpoints. On failure,
+ * the tree is restored. */
+static bool insert_sorted(struct ostree *tree, const struct list *batch, int (*compare)(const void *, const void *),
+		size_t *insertpoints)
 {
-	size_t index;
-	bool found = list_find_item_or_insertpoint(model->addchange_queue, listcompare_strcmp, filename, &index);
-	if(!found) {
-		char *filename_copy = strdup(filename);
-		if(filename_copy == NULL)
-			return ENOMEM;
-		if(!list_insert(model->addchange_queue, index, filename_copy)) {
-			free(filename_copy);
-			return ENOMEM;
+	size_t batchlength = list_length(batch);
+	size_t added = 0;
+
+	for(size_t j = 0; j < batchlength; j++) {
+		if(batch_is_hidden(batch, j))
+			continue;
+
+		size_t index;
+		void *item = list_get_item(batch, j);
+		ostree_find_item_or_insertpoint(tree, compare, item, &index);
+		if(!ostree_insert(tree, index, item)) {
+			/* the entries before came in ascending order, so each
+			 * one is still, where it was inserted */
+			while(added > 0) {
+				added--;
+				ostree_remove(tree, insertpoints[added] + added);
+			}
+			return false;
 		}
+		insertpoints[added] = index - added;
+		added++;
 	}
-	return 0;
+	return true;
 }
 
-int dirmodel_notify_flush(struct dirmodel *model)
+static size_t dirmodel_added_before(struct listmodel *listmodel, size_t oldindex)
 {
-	int ret = 0;
-	size_t length = list_length(model->addchange_queue);
-	for(size_t i = 0; i < length; i++) {
-		ret = dirmodel_notify_file_added_or_changed_real(model, list_get_item(model->addchange_queue, i));
-		if(ret == ENOMEM)
-			break;
+	struct dirmodel *model = container_of(listmodel, struct dirmodel, listmodel);
+	size_t min = 0, max = model->added_count;
+
+	while(min < max) {
+		size_t middle = min + (max - min) / 2;
+		if(model->added_insertpoints[middle] <= oldindex)
+			min = middle + 1;
+		else
+			max = middle;
 	}
-	for(size_t i = length; i > 0; i--) {
-		free(list_get_item(model->addchange_queue, i - 1));
-		list_remove(model->addchange_queue, i - 1);
+	return min;
+}
+
+/* Announces the entries added to a list of oldlength entries with a single
+ * notification, views find out through dirmodel_added_before, where their
+ * cursor went. */
+static void notify_added(struct dirmodel *model, size_t oldlength, const size_t *insertpoints, size_t count)
+{
+	if(count == 0)
+		return;
+	if(oldlength == 0) {
+		listmodel_notify_change(&model->listmodel, MODEL_RELOAD, 0, 0);
+		return;
+	}
+	if(count == 1) {
+		shift_shown_range(model, insertpoints[0] <= model->shown_first, 0);
+		listmodel_notify_change(&model->listmodel, MODEL_ADD, insertpoints[0], 0);
+		return;
 	}
-	return ret == ENOMEM ? ENOMEM : 0;
+
+	model->added_insertpoints = insertpoints;
+	model->added_count = count;
+	shift_shown_range(model, dirmodel_added_before(&model->listmodel, model->shown_first), 0);
+	listmodel_notify_change(&model->listmodel, MODEL_ADD_BATCH, insertpoints[0], count);
+	model->added_insertpoints = NULL;
+	model->added_count = 0;
 }
 
-const char *dirmodel_getfilename(struct dirmodel *model, size_t index)
+static size_t dirmodel_removed_before(struct listmodel *listmodel, size_t oldindex)
 {
-	struct list *list = model->sortedlist;
-	struct filedata *filedata = list_get_item(list, index);
-	return filedata->filename;
+	struct dirmodel *model = container_of(listmodel, struct dirmodel, listmodel);
+	size_t min = 0, max = model->removed_count;
+
+	while(min < max) {
+		size_t middle = min + (max - min) / 2;
+		if(model->removed_indexes[middle] < oldindex)
+			min = middle + 1;
+		else
+			max = middle;
+	}
+	return min;
 }
 
-const struct filedata *dirmodel_getfiledata(struct dirmodel *model, size_t index)
+/* Announces the removal of the entries at the ascending old indexes with a
+ * single notification, see notify_added. */
+static void notify_removed(struct dirmodel *model, const size_t *indexes, size_t count)
 {
-	return list_get_item(model->sortedlist, index);
+	if(count == 0)
+		return;
+	if(count == 1) {
+		shift_shown_range(model, 0, indexes[0] < model->shown_first);
+		listmodel_notify_change(&model->listmodel, MODEL_REMOVE, 0, indexes[0]);
+		return;
+	}
+
+	model->removed_indexes = indexes;
+	model->removed_count = count;
+	shift_shown_range(model, 0, dirmodel_removed_before(&model->listmodel, model->shown_first));
+	listmodel_notify_change(&model->listmodel, MODEL_REMOVE_BATCH, 0, count);
+	model->removed_indexes = NULL;
+	model->removed_count = 0;
 }
 
-off_t dirmodel_getdirsize(struct dirmodel *model)
+/* Adds a batch of new entries to the model. They are sorted once and then
+ * merged into the sorted list in a single pass or, if the list is much
+ * longer, inserted one by one. On success, the model takes ownership of the
+ * entries, otherwise it stays untouched. */
+static int dirmodel_merge_batch(struct dirmodel *model, struct list *batch, bool notify)
 {
-	return model->dirsize;
+	drop_unwanted_entries(model, batch);
+
+	size_t oldlength = ostree_length(model->sortedlist);
+	size_t batchlength = list_length(batch);
+	size_t shown = 0, j;
+	if(batchlength == 0)
+		return 0;
+
+	if(sort_mode_needs_stat(model->sorted_mode))
+		resolve_entries(model, batch);
+	sort_batch(batch, model->sorted_mode);
+
+	for(j = 0; j < batchlength; j++)
+		if(!batch_is_hidden(batch, j))
+			shown++;
+	size_t *insertpoints = malloc((shown > 0 ? shown : 1) * sizeof(insertpoints[0]));
+	if(insertpoints == NULL)
+		return ENOMEM;
+
+	for(j = 0; j < batchlength; j++)
+		if(!hashset_insert(&model->names, list_get_item(batch, j)))
+			goto err_names;
+
+	if(shown * MERGE_MIN_RATIO < oldlength) {
+		if(!insert_sorted(model->sortedlist, batch, model->sort_compare, insertpoints))
+			goto err_names;
+	} else {
+		struct ostree *sortedlist = merge_sorted(model->sortedlist, batch, model->sort_compare, insertpoints);
+		if(sortedlist == NULL)
+			goto err_names;
+		ostree_delete(model->sortedlist, NULL);
+		model->sortedlist = sortedlist;
+	}
+
+	for(j = 0; j < batchlength; j++) {
+		struct filedata *filedata = list_get_item(batch, j);
+		if(filedata->is_hidden)
+			continue;
+		if(filedata->is_stat_pending) {
+			/* the cached lists cannot take entries, whose position
+			 * may still change with their stat data */
+			sortcache_clear(model);
+			model->pending_count++;
+		} else {
+			sortcache_insert(model, filedata);
+			dirmodel_update_dirsize(model, NULL, filedata);
+		}
+	}
+
+	if(notify)
+		notify_added(model, oldlength, insertpoints, shown);
+	free(insertpoints);
+	return 0;
+
+err_names:
+	while(j > 0) {
+		struct filedata *filedata = list_get_item(batch, --j);
+		hashset_remove(&model->names, filedata->filename);
+	}
+	free(insertpoints);
+	return ENOMEM;
 }
 
-bool dirmodel_isdir(struct dirmodel *model, size_t index)
+static int compare_index(const void *a, const void *b)
 {
-	struct list *list = model->sortedlist;
-	struct filedata *filedata = list_get_item(list, index);
-	return S_ISDIR(filedata->stat.st_mode);
+	size_t index1 = *(const size_t *)a, index2 = *(const size_t *)b;
+
+	return (index1 > index2) - (index1 < index2);
 }
 
-static bool internal_init(struct dirmodel *model, const char *path)
+/* Copies the tree without the items at the ascending indexes in one pass,
+ * which is cheaper than removing them one by one, if there are many. */
+static struct ostree *compact_sorted(const struct ostree *tree, const size_t *indexes, size_t count)
 {
-	DIR *dir;
-	struct filedata *filedata;
+	struct ostree_cursor cursor;
+	size_t index = 0, j = 0;
 
-	dir = opendir(path);
-	if(dir == NULL)
-		goto err_opendir;
+	struct ostree *kept = ostree_new();
+	if(kept == NULL)
+		return NULL;
 
-	model->addchange_queue = list_new(0);
-	if(model->addchange_queue == NULL)
-		goto err_new_addchange_queue;
+	for(void *item = ostree_seek(tree, 0, &cursor); item; item = ostree_next(&cursor), index++) {
+		if(j < count && indexes[j] == index) {
+			j++;
+			continue;
+		}
+		if(!ostree_append(kept, item)) {
+			ostree_delete(kept, NULL);
+			return NULL;
+		}
+	}
+	return kept;
+}
 
-	struct list *list = list_new(0);
-	if(list == NULL)
-		goto err_newlist;
+/* A deleted name, that has no entry, may still come with a batch of the
+ * running load, so it is remembered until the load is done. Without memory
+ * for it, the entry shows up until the next reload. */
+static bool remember_deleted(struct dirmodel *model, const char *filename)
+{
+	return !dirmodel_isloading(model) || namequeue_add(&model->loading_deleted, filename, 0);
+}
 
-	struct list *sortedlist = list_new(0);
-	if(sortedlist == NULL)
-		goto err_newsortedlist;
+/* Removes the entries of all queued names, that were deleted last. Their
+ * files are not looked at, and the shown ones leave the sorted list together
+ * with a single notification. Without memory for that, they are removed one
+ * by one. */
+static void dirmodel_flush_deleted(struct dirmodel *model)
+{
+	struct namequeue *queue = &model->event_queue;
+	size_t length = namequeue_length(queue);
+	size_t deleted = 0, count = 0, i;
+
+	for(i = 0; i < length; i++)
+		if(namequeue_gettag(queue, i) == QUEUED_DELETED)
+			deleted++;
+	if(deleted == 0)
+		return;
 
+	size_t *indexes = malloc(deleted * sizeof(indexes[0]));
+	struct filedata **removed = malloc(deleted * sizeof(removed[0]));
+	if(indexes == NULL || removed == NULL) {
+		free(indexes);
+		free(removed);
+		for(i = 0; i < length; i++) {
+			if(namequeue_gettag(queue, i) != QUEUED_DELETED)
+				continue;
+			struct filedata *filedata = hashset_get(&model->names, namequeue_get(queue, i));
+			if(filedata != NULL)
+				dirmodel_remove_file(model, filedata);
+			else
+				remember_deleted(model, namequeue_get(queue, i));
+		}
+		return;
+	}
 
-	model->dirsize = 0;
-	for(struct dirent *entry = readdir(dir); entry; entry = readdir(dir)) {
-		if(strcmp(entry->d_name, ".") != 0 &&
-		   strcmp(entry->d_name, "..") != 0 &&
-		   (model->filter_active ? regexec(&model->filter, entry->d_name, 0, NULL, 0) == 0 : true)) {
-			int ret = filedata_new_from_file(&filedata, dirfd(dir), entry->d_name);
+	for(i = 0; i < length; i++) {
+		if(namequeue_gettag(queue, i) != QUEUED_DELETED)
+			continue;
+		struct filedata *filedata = hashset_get(&model->names, namequeue_get(queue, i));
+		if(filedata == NULL) {
+			remember_deleted(model, namequeue_get(queue, i));
+			continue;
+		}
+		if(dirmodel_find(model, filedata->filename, &indexes[count])) {
+			/* freed only after the search for the others */
+			forget_entry(model, filedata);
+			removed[count++] = filedata;
+		} else {
+			hashset_remove(&model->names, filedata->filename);
+			filedata_arena_delete(&model->arena, filedata);
+		}
+	}
+	qsort(indexes, count, sizeof(indexes[0]), compare_index);
+
+	struct ostree *kept = NULL;
+	if(count * MERGE_MIN_RATIO >= ostree_length(model->sortedlist))
+		kept = compact_sorted(model->sortedlist, indexes, count);
+	if(kept != NULL) {
+		ostree_delete(model->sortedlist, NULL);
+		model->sortedlist = kept;
+	} else {
+		/* from the back, so that the other indexes stay valid */
+		for(i = count; i > 0; i--)
+			ostree_remove(model->sortedlist, indexes[i - 1]);
+	}
+	notify_removed(model, indexes, count);
 
-			if(ret == ENOMEM)
-				goto err_readdir;
+	for(i = 0; i < count; i++) {
+		hashset_remove(&model->names, removed[i]->filename);
+		filedata_arena_delete(&model->arena, removed[i]);
+	}
+	free(indexes);
+	free(removed);
+}
+
+/* Tells, whether a changed entry is to be stat'ed now. A file, that keeps
+ * changing, waits longer and longer between two stats, so that busy log
+ * files do not cost a stat with each flush. Names, whose hashes share a slot,
+ * only make each other be stat'ed earlier. */
+static bool restat_due(struct dirmodel *model, const char *filename, uint64_t now)
+{
+	if(model->restats == NULL) {
+		model->restats = malloc(DIRMODEL_RESTAT_SLOTS * sizeof(model->restats[0]));
+		if(model->restats == NULL)
+			return true;
+		memset(model->restats, 0, DIRMODEL_RESTAT_SLOTS * sizeof(model->restats[0]));
+	}
 
-			if(ret != 0)
+	size_t hash = hashset_hash(filename);
+	struct dirmodel_restat *restat = &model->restats[hash & (DIRMODEL_RESTAT_SLOTS - 1)];
+	if(restat->hash != hash || now - restat->last >= RESTAT_QUIET_TIME) {
+		restat->hash = hash;
+		restat->interval = 0;
+	} else if(now - restat->last < restat->interval) {
+		return false;
+	} else if(restat->interval == 0) {
+		restat->interval = RESTAT_MIN_INTERVAL;
+	} else if(restat->interval < RESTAT_MAX_INTERVAL) {
+		restat->interval *= 2;
+		if(restat->interval > RESTAT_MAX_INTERVAL)
+			restat->interval = RESTAT_MAX_INTERVAL;
+	}
+	restat->last = now;
+	return true;
+}
+
+/* In an order by name, a changed entry keeps its position, so if no view
+ * shows it, it becomes pending again instead of being stat'ed now, and gets
+ * resolved, when it is rendered or needed otherwise. */
+static bool restat_when_shown(struct dirmodel *model, struct filedata *filedata)
+{
+	size_t index;
+
+	if(sort_mode_needs_stat(model->sorted_mode) || filedata->is_marked || S_ISDIR(filedata->mode))
+		return false;
+	if(!dirmodel_find(model, filedata->filename, &index))
+		return false;
+	if(index >= model->shown_first && index - model->shown_first < model->shown_count)
+		return false;
+
+	if(!filedata->is_stat_pending) {
+		dirmodel_update_dirsize(model, filedata, NULL);
+		filedata->is_stat_pending = true;
+		model->pending_count++;
+		sortcache_clear_stat_modes(model);
+	}
+	return true;
+}
+
+/* Stats all queued names, that were added or changed last, in one go, except
+ * for entries, that are not shown or changed too often, see above. Entries,
+ * that are known already, are updated, the new ones are added to the list
+ * together as one batch. */
+static int dirmodel_flush_queue(struct dirmodel *model)
+{
+	size_t length = namequeue_length(&model->event_queue);
+	size_t changed = 0, added = 0;
+	int ret = 0;
+
+	for(size_t i = 0; i < length; i++)
+		if(namequeue_gettag(&model->event_queue, i) != QUEUED_DELETED)
+			changed++;
+	if(changed == 0)
+		return 0;
+
+	struct list *entries = list_new(changed);
+	if(entries == NULL)
+		return ENOMEM;
+
+	uint64_t now = monotonic_ms();
+	for(size_t i = 0; i < length; i++) {
+		const char *filename = namequeue_get(&model->event_queue, i);
+		struct filedata *filedata;
+		if(namequeue_gettag(&model->event_queue, i) == QUEUED_DELETED)
+			continue;
+
+		filedata = hashset_get(&model->names, filename);
+		if(filedata != NULL && !filedata->is_hidden) {
+			if(restat_when_shown(model, filedata))
+				continue;
+			if(!restat_due(model, filename, now) && namequeue_add(&model->deferred_queue, filename, QUEUED_ADDED_OR_CHANGED))
 				continue;
+		}
 
-			if(!list_append(sortedlist, filedata))
-				goto err_readdir;
-			if(!list_append(list, filedata))
-				goto err_readdir;
+		if(filedata_arena_new(&model->arena, &filedata, filename) != 0)
+			goto err_entries;
+		if(!list_append(entries, filedata)) {
+			filedata_arena_delete(&model->arena, filedata);
+			goto err_entries;
+		}
+	}
+	if(statpool_stat_list(&model->statpool, model->dir_fd, entries, &model->arena) != 0)
+		goto err_entries;
+
+	length = list_length(entries);
+	for(size_t i = 0; i < length; i++) {
+		struct filedata *filedata = list_get_item(entries, i);
+
+		struct filedata *oldfiledata = hashset_get(&model->names, filedata->filename);
+		if(oldfiledata == NULL) {
+			filedata->is_hidden = dirmodel_filters_out(model, filedata->filename);
+			list_set_item(entries, added++, filedata);
+			continue;
+		}
+		if(dirmodel_update_file(model, oldfiledata, filedata) == ENOMEM)
+			ret = ENOMEM;
+		filedata_arena_delete(&model->arena, filedata);
+	}
+	for(size_t i = length; i > added; i--)
+		list_remove(entries, i - 1);
+
+	if(dirmodel_merge_batch(model, entries, true) != 0)
+		goto err_entries;
+	list_delete(entries, NULL);
+	return ret;
+
+err_entries:
+	for(size_t i = 0; i < list_length(entries); i++)
+		filedata_arena_delete(&model->arena, list_get_item(entries, i));
+	list_delete(entries, NULL);
+	return ENOMEM;
+}
+
+int dirmodel_notify_flush(struct dirmodel *model)
+{
+	int ret = 0;
+
+	/* the directory is not opened yet, keep the events for later */
+	if(model->dir_fd < 0)
+		return 0;
+
+	size_t length = namequeue_length(&model->event_queue);
+	if(length > 0) {
+		dirmodel_flush_deleted(model);
+		ret = dirmodel_flush_queue(model);
+	}
+	/* an entry, whose type changed, is queued again while flushing, in
+	 * that case the queue is kept and taken completely with the next flush,
+	 * otherwise only the names, whose stat was put off, are left for it */
+	if(namequeue_length(&model->event_queue) == length) {
+		struct namequeue deferred = model->deferred_queue;
+		namequeue_clear(&model->event_queue);
+		model->deferred_queue = model->event_queue;
+		model->event_queue = deferred;
+	} else {
+		namequeue_clear(&model->deferred_queue);
+	}
+	dirmodel_compact(model);
+	return ret;
+}
+
+/* Names, that are still to be flushed, including those, that wait, because
+ * their files change too often. */
+size_t dirmodel_getqueuedcount(struct dirmodel *model)
+{
+	return namequeue_length(&model->event_queue);
+}
+
+/* Counts the sizes, pending and marked entries of the shown entries anew. */
+static void dirmodel_recount(struct dirmodel *model)
+{
+	struct ostree_cursor cursor;
+
+	model->dirsize = 0;
+	model->pending_count = 0;
+	model->marked_stats.count = 0;
+	model->marked_stats.size = 0;
+
+	for(struct filedata *filedata = ostree_seek(model->sortedlist, 0, &cursor); filedata; filedata = ostree_next(&cursor)) {
+		if(filedata->is_stat_pending)
+			model->pending_count++;
+		else
 			dirmodel_update_dirsize(model, NULL, filedata);
+		if(filedata->is_marked)
+			dirmodel_update_marked_stats(model, NULL, filedata);
+	}
+}
+
+/* Applies a changed filter without sorting all entries again. The shown
+ * entries, that still pass, keep their order, and only the hidden ones, that
+ * pass now, are sorted and merged in. As long as the filter only got
+ * narrower, the hidden entries are not even looked at. */
+static int dirmodel_refilter(struct dirmodel *model)
+{
+	struct ostree_cursor cursor;
+	size_t position = 0;
+
+	struct list *revealed = list_new(0);
+	if(revealed == NULL)
+		return ENOMEM;
+	struct ostree *kept = ostree_new();
+	if(kept == NULL)
+		goto err_revealed;
+
+	for(struct filedata *filedata = ostree_seek(model->sortedlist, 0, &cursor); filedata; filedata = ostree_next(&cursor)) {
+		if(!dirmodel_filters_out(model, filedata->filename) && !ostree_append(kept, filedata))
+			goto err_kept;
+	}
+
+	if(!model->filter_narrowed) {
+		for(struct filedata *filedata; (filedata = hashset_next(&model->names, &position)); ) {
+			if(filedata->is_hidden && !dirmodel_filters_out(model, filedata->filename))
+				if(!list_append(revealed, filedata))
+					goto err_kept;
+		}
+		if(sort_mode_needs_stat(model->sorted_mode))
+			resolve_entries(model, revealed);
+		sort_batch(revealed, model->sorted_mode);
+	}
+
+	struct ostree *sortedlist = kept;
+	size_t length = list_length(revealed);
+	if(length > 0) {
+		/* merge_sorted skips hidden entries */
+		for(size_t i = 0; i < length; i++)
+			((struct filedata *)list_get_item(revealed, i))->is_hidden = false;
+		sortedlist = merge_sorted(kept, revealed, model->sort_compare, NULL);
+		ostree_delete(kept, NULL);
+		if(sortedlist == NULL) {
+			for(size_t i = 0; i < length; i++)
+				((struct filedata *)list_get_item(revealed, i))->is_hidden = true;
+			goto err_revealed;
 		}
 	}
-	model->dir = dir;
-	model->list = list;
+	list_delete(revealed, NULL);
+
+	for(struct filedata *filedata = ostree_seek(model->sortedlist, 0, &cursor); filedata; filedata = ostree_next(&cursor))
+		filedata->is_hidden = true;
+	for(struct filedata *filedata = ostree_seek(sortedlist, 0, &cursor); filedata; filedata = ostree_next(&cursor))
+		filedata->is_hidden = false;
+
+	ostree_delete(model->sortedlist, NULL);
 	model->sortedlist = sortedlist;
+	model->filter_narrowed = true;
+
+	dirmodel_recount(model);
+	listmodel_notify_change(&model->listmodel, MODEL_RELOAD, 0, 0);
+	return 0;
+
+err_kept:
+	ostree_delete(kept, NULL);
+err_revealed:
+	list_delete(revealed, NULL);
+	dirmodel_recount(model);
+	return ENOMEM;
+}
 
-	list_sort(list, filedata_listcompare_filename);
-	list_sort(sortedlist, model->sort_compare);
+/* Applies a changed sort mode or filter to the entries, that are loaded
+ * already, without reading the directory again. All entries keep their
+ * marks, also those, that are hidden for a while. If memory is short, the
+ * model stays as it was. */
+int dirmodel_rearrange(struct dirmodel *model)
+{
+	struct ostree_cursor cursor;
+	size_t position = 0;
+	bool refiltered = false;
+
+	if(model->sortedlist == NULL)
+		return 0;
+
+	/* the filter is the same as when the list was cached, otherwise the
+	 * cache would have been cleared */
+	if(model->sorted_mode == model->sort_mode)
+		return dirmodel_refilter(model);
+
+	struct ostree *cached = model->sortcache[model->sort_mode];
+	if(cached) {
+		model->sortcache[model->sort_mode] = NULL;
+		sortcache_store(model, model->sorted_mode, model->sortedlist);
+		model->sortedlist = cached;
+		use_sort_mode(model, model->sort_mode);
+		listmodel_notify_change(&model->listmodel, MODEL_RELOAD, 0, 0);
+		return 0;
+	}
+
+	struct list *entries = list_new(hashset_length(&model->names));
+	if(entries == NULL)
+		return ENOMEM;
+
+	for(struct filedata *filedata; (filedata = hashset_next(&model->names, &position)); ) {
+		bool hidden = dirmodel_filters_out(model, filedata->filename);
+		if(hidden != filedata->is_hidden)
+			refiltered = true;
+		if(!hidden && !list_append(entries, filedata))
+			goto err_entries;
+	}
+
+	if(sort_mode_needs_stat(model->sort_mode))
+		resolve_entries(model, entries);
+	sort_batch(entries, model->sort_mode);
+
+	struct ostree *sortedlist = ostree_new();
+	if(sortedlist == NULL)
+		goto err_entries;
+	for(size_t i = 0; i < list_length(entries); i++) {
+		if(!ostree_append(sortedlist, list_get_item(entries, i))) {
+			ostree_delete(sortedlist, NULL);
+			goto err_entries;
+		}
+	}
+	list_delete(entries, NULL);
 
+	if(refiltered)
+		ostree_delete(model->sortedlist, NULL);
+	else
+		sortcache_store(model, model->sorted_mode, model->sortedlist);
+	model->sortedlist = sortedlist;
+	use_sort_mode(model, model->sort_mode);
+
+	position = 0;
+	for(struct filedata *filedata; (filedata = hashset_next(&model->names, &position)); )
+		filedata->is_hidden = true;
+	for(struct filedata *filedata = ostree_seek(sortedlist, 0, &cursor); filedata; filedata = ostree_next(&cursor))
+		filedata->is_hidden = false;
+
+	model->filter_narrowed = true;
+
+	dirmodel_recount(model);
+	listmodel_notify_change(&model->listmodel, MODEL_RELOAD, 0, 0);
+	return 0;
+
+err_entries:
+	list_delete(entries, NULL);
+	/* resolving may have changed what is counted */
+	dirmodel_recount(model);
+	return ENOMEM;
+}
+
+static void load_options(struct dirmodel *model, struct dirloader_options *options)
+{
+	options->defer = model->load_mode == DIRMODEL_LOAD_DEFERRED && !sort_mode_needs_stat(model->sort_mode);
+	options->first_batch_size = model->first_batch_size;
+	options->statpool = model->statpool;
+}
+
+static bool internal_init(struct dirmodel *model)
+{
+	namequeue_init(&model->event_queue);
+	namequeue_init(&model->deferred_queue);
+	namequeue_init(&model->loading_deleted);
+
+	model->sortedlist = ostree_new();
+	if(model->sortedlist == NULL)
+		return false;
+
+	model->dir_fd = -1;
+	use_sort_mode(model, model->sort_mode);
+	model->filter_narrowed = true;
+	hashset_init(&model->names, filedata_key);
+	arena_init(&model->arena);
+	model->dirsize = 0;
+	model->pending_count = 0;
 	model->marked_stats.count = 0;
 	model->marked_stats.size = 0;
+	/* until a view tells otherwise, everything counts as shown */
+	model->shown_first = 0;
+	model->shown_count = SIZE_MAX;
+	/* files of another directory are not rate limited by those of this one */
+	if(model->restats != NULL)
+		memset(model->restats, 0, DIRMODEL_RESTAT_SLOTS * sizeof(model->restats[0]));
 
 	return true;
-
-err_readdir:
-	filedata_delete(filedata);
-	list_delete(sortedlist, NULL);
-err_newsortedlist:
-	list_delete(list, (list_item_deallocator)filedata_delete);
-err_newlist:
-	list_delete(model->addchange_queue, NULL);
-err_new_addchange_queue:
-	closedir(dir);
-err_opendir:
-	return false;
 }
 
 static void internal_destroy(struct dirmodel *model)
 {
-	struct list *list = model->list;
-	if(list == NULL)
+	if(model->sortedlist == NULL)
 		return;
 
-	closedir(model->dir);
-
-	list_delete(list, (list_item_deallocator)filedata_delete);
-	list_delete(model->sortedlist, NULL);
-	list_delete(model->addchange_queue, free);
-	model->list = NULL;
+	dirloader_cancel(&model->loader);
+	if(model->dir_fd >= 0)
+		close(model->dir_fd);
+
+	/* all entries go at once with their arena */
+	sortcache_clear(model);
+	ostree_delete(model->sortedlist, NULL);
+	hashset_destroy(&model->names, NULL);
+	arena_destroy(&model->arena);
+	namequeue_destroy(&model->event_queue);
+	namequeue_destroy(&model->deferred_queue);
+	namequeue_destroy(&model->loading_deleted);
+	model->sortedlist = NULL;
+	model->generation++;
 }
 
 bool dirmodel_change_directory(struct dirmodel *model, const char *path)
 {
+	struct dirloader_options options;
+	struct list *entries;
+
+	internal_destroy(model);
+	if(!internal_init(model))
+		return false;
+
+	load_options(model, &options);
+	int ret = dirloader_load(path, &options, &model->dir_fd, &entries, &model->arena);
+	model->statpool.use_io_uring = options.statpool.use_io_uring;
+	if(ret != 0)
+		goto err_load;
+
+	if(dirmodel_merge_batch(model, entries, false) != 0) {
+		list_delete(entries, NULL);
+		goto err_load;
+	}
+	list_delete(entries, NULL);
+
+	listmodel_notify_change(&model->listmodel, MODEL_RELOAD, 0, 0);
+	return true;
+
+err_load:
+	internal_destroy(model);
+	return false;
+}
+
+/* Like dirmodel_change_directory, but the directory is read in a background
+ * thread and the model starts out empty. The entries arrive in batches,
+ * which dirmodel_collect_batches adds, whenever the descriptor returned by
+ * dirmodel_getloadfd becomes readable. */
+bool dirmodel_begin_change_directory(struct dirmodel *model, const char *path)
+{
+	struct dirloader_options options;
+
 	internal_destroy(model);
-	if(!internal_init(model, path))
+	if(!internal_init(model))
 		return false;
+
+	load_options(model, &options);
+	if(!dirloader_start(&model->loader, path, &options)) {
+		/* no thread, so do it the old way */
+		internal_destroy(model);
+		return dirmodel_change_directory(model, path);
+	}
+
 	listmodel_notify_change(&model->listmodel, MODEL_RELOAD, 0, 0);
 	return true;
 }
 
+/* Adds all batches, that were loaded so far. Returns the error, that ended
+ * the loading, if any. */
+int dirmodel_collect_batches(struct dirmodel *model)
+{
+	if(model->sortedlist == NULL)
+		return 0;
+
+	while(1) {
+		struct list *batch;
+		int dir_fd;
+
+		int ret = dirloader_take(&model->loader, &dir_fd, &batch, &model->arena, &model->statpool);
+		if(dir_fd >= 0)
+			model->dir_fd = dir_fd;
+		if(ret == EAGAIN)
+			return 0;
+		if(ret != 0 || batch == NULL) {
+			namequeue_destroy(&model->loading_deleted);
+			return ret;
+		}
+
+		ret = dirmodel_merge_batch(model, batch, true);
+		if(ret != 0) {
+			/* keep, what is there, but give up on the rest */
+			for(size_t i = 0; i < list_length(batch); i++)
+				filedata_arena_delete(&model->arena, list_get_item(batch, i));
+			list_delete(batch, NULL);
+			dirloader_cancel(&model->loader);
+			namequeue_destroy(&model->loading_deleted);
+			return ret;
+		}
+		list_delete(batch, NULL);
+	}
+}
+
+int dirmodel_getloadfd(struct dirmodel *model)
+{
+	return model->loader.eventfd;
+}
+
+bool dirmodel_isloading(struct dirmodel *model)
+{
+	return dirloader_isrunning(&model->loader);
+}
+
+/* Tells, whether the directory, that is loaded, could be opened. After an
+ * error, this tells a directory, that cannot be entered, from one, that
+ * failed while being read. */
+bool dirmodel_isopen(struct dirmodel *model)
+{
+	return model->dir_fd >= 0;
+}
+
 void dirmodel_init(struct dirmodel *model)
 {
 	listmodel_init(&model->listmodel);
 
-	model->list = NULL;
 	model->sortedlist = NULL;
+	model->generation = 0;
+	model->dir_fd = -1;
+	model->first_batch_size = DIRMODEL_FIRST_BATCH_SIZE;
 	model->listmodel.count = dirmodel_count;
 	model->listmodel.render = dirmodel_render;
 	model->listmodel.setmark = dirmodel_setmark;
 	model->listmodel.ismarked = dirmodel_ismarked;
-	model->filter_active = false;
-	model->sort_compare = filedata_listcompare_directory_filename;
+	model->listmodel.prefetch = dirmodel_prefetch;
+	model->listmodel.added_before = dirmodel_added_before;
+	model->listmodel.removed_before = dirmodel_removed_before;
+	model->filter.pattern = NULL;
+	model->filter_narrowed = true;
+	model->search.pattern = NULL;
+	model->sort_mode = DIRMODEL_FILENAME;
+	use_sort_mode(model, DIRMODEL_FILENAME);
+	for(size_t mode = 0; mode < DIRMODEL_SORT_MODES; mode++)
+		model->sortcache[mode] = NULL;
+	model->sortcache_clock = 0;
+	model->sortcache_limit = DIRMODEL_SORTCACHE_LIMIT;
+	model->load_mode = DIRMODEL_LOAD_FULL;
+	model->pending_count = 0;
+	model->restats = NULL;
+	statpool_init(&model->statpool);
+	dirloader_init(&model->loader);
 }
 
 void dirmodel_destroy(struct dirmodel *model)
 {
 	internal_destroy(model);
+	free(model->restats);
+	dirloader_destroy(&model->loader);
 	listmodel_destroy(&model->listmodel);
-	if(model->filter_active)
-		regfree(&model->filter);
+	matcher_destroy(&model->filter);
+	matcher_destroy(&model->search);
 }
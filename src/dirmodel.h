@@ -2,32 +2,33 @@
 #ifndef DIRMODEL_H
 #define DIRMODEL_H
 
+#include "arena.h"
+#include "dirloader.h"
+#include "hashset.h"
 #include "listmodel.h"
+#include "matcher.h"
+#include "namequeue.h"
+#include "statpool.h"
 
-#include <dirent.h>
-#include <regex.h>
+#include <stdint.h>
 #include <sys/types.h>
 
 struct filedata;
+struct ostree;
 
 struct marked_stats {
 	size_t count;
 	off_t size;
 };
 
-struct dirmodel {
-	struct listmodel listmodel;
-	struct list *list;
-	struct list *sortedlist;
-	struct list *addchange_queue;
-	DIR *dir;
-	regex_t filter;
-	bool filter_active;
-	int (*sort_compare)(const void *, const void *);
-	bool sort_ascending;
-	struct marked_stats marked_stats;
-	off_t dirsize;
+/* when a changed file was stat'ed last and how long its next change waits,
+ * found by the hash of its name */
+struct dirmodel_restat {
+	size_t hash;
+	uint64_t last;
+	unsigned int interval;
 };
+#define DIRMODEL_RESTAT_SLOTS 4096
 
 enum dirmodel_sort_mode {
 	DIRMODEL_FILENAME,
@@ -37,22 +38,94 @@ enum dirmodel_sort_mode {
 	DIRMODEL_MTIME,
 	DIRMODEL_MTIME_DESCENDING,
 };
+#define DIRMODEL_SORT_MODES (DIRMODEL_MTIME_DESCENDING + 1)
+
+enum dirmodel_load_mode {
+	DIRMODEL_LOAD_FULL,
+	DIRMODEL_LOAD_DEFERRED,
+};
+
+struct dirmodel {
+	struct listmodel listmodel;
+	/* entries by name and in display order */
+	struct hashset names;
+	struct ostree *sortedlist;
+	struct namequeue event_queue;
+	/* changed names, that wait for a later flush */
+	struct namequeue deferred_queue;
+	/* names deleted, while the directory is being read, before their
+	 * entries arrived, so that the batches do not bring them back */
+	struct namequeue loading_deleted;
+	struct dirmodel_restat *restats;
+	int dir_fd;
+	/* all entries of the current directory */
+	struct arena arena;
+	/* changes, whenever entries are moved or freed without a notification,
+	 * so that pointers to them can be checked */
+	unsigned long generation;
+	size_t first_batch_size;
+	struct matcher filter;
+	/* the filter only hid more entries since they were last arranged */
+	bool filter_narrowed;
+	/* the last searched pattern */
+	struct matcher search;
+	/* order of sortedlist and the one to use with the next rearrangement */
+	int (*sort_compare)(const void *, const void *);
+	enum dirmodel_sort_mode sorted_mode;
+	enum dirmodel_sort_mode sort_mode;
+	/* sorted lists of the shown entries for other recently used sort
+	 * modes, kept up to date, so that switching back needs no sorting */
+	struct ostree *sortcache[DIRMODEL_SORT_MODES];
+	unsigned long sortcache_used[DIRMODEL_SORT_MODES];
+	unsigned long sortcache_clock;
+	size_t sortcache_limit;
+	bool sort_ascending;
+	/* where the entries of the batch, that is being announced, went in
+	 * the list from before, in ascending order */
+	const size_t *added_insertpoints;
+	size_t added_count;
+	/* the old indexes of the entries, whose removal is being announced,
+	 * in ascending order */
+	const size_t *removed_indexes;
+	size_t removed_count;
+	/* the part of the list, that a view asked for last, with its margin */
+	size_t shown_first;
+	size_t shown_count;
+	struct marked_stats marked_stats;
+	off_t dirsize;
+	size_t pending_count;
+	enum dirmodel_load_mode load_mode;
+	struct statpool statpool;
+	struct dirloader loader;
+};
 
 const char *dirmodel_getfilename(struct dirmodel *model, size_t index);
 const struct filedata *dirmodel_getfiledata(struct dirmodel *model, size_t index);
 off_t dirmodel_getdirsize(struct dirmodel *model);
+size_t dirmodel_getpendingcount(struct dirmodel *model);
 int dirmodel_getmarkedfilenames(struct dirmodel *model, const struct list **markedlist_out) __attribute__((warn_unused_result));
 struct marked_stats dirmodel_getmarkedstats(struct dirmodel *model);
 void dirmodel_notify_file_deleted(struct dirmodel *model, const char *filename);
 int dirmodel_notify_file_added_or_changed(struct dirmodel *model, const char *filename);
 int dirmodel_notify_flush(struct dirmodel *model);
+size_t dirmodel_getqueuedcount(struct dirmodel *model);
 bool dirmodel_isdir(struct dirmodel *model, size_t index);
 bool dirmodel_get_index(struct dirmodel *model, const char *filename, size_t *index);
 size_t dirmodel_regex_getnext(struct dirmodel *model, const char *regex, size_t start_index, int direction);
-void dirmodel_regex_setmark(struct dirmodel *model, const char *regex, bool mark);
+bool dirmodel_find_prefix(struct dirmodel *model, const char *prefix, size_t *index);
+bool dirmodel_regex_setmark(struct dirmodel *model, const char *regex, bool mark);
 bool dirmodel_setfilter(struct dirmodel *model, const char *regex);
+const char *dirmodel_getfilter(struct dirmodel *model);
 void dirmodel_set_sort_mode(struct dirmodel *model, enum dirmodel_sort_mode mode);
+void dirmodel_set_load_mode(struct dirmodel *model, enum dirmodel_load_mode mode);
+void dirmodel_set_sortcache_limit(struct dirmodel *model, size_t limit);
+int dirmodel_rearrange(struct dirmodel *model) __attribute__((warn_unused_result));
 bool dirmodel_change_directory(struct dirmodel *model, const char *path) __attribute__((warn_unused_result));
+bool dirmodel_begin_change_directory(struct dirmodel *model, const char *path) __attribute__((warn_unused_result));
+int dirmodel_collect_batches(struct dirmodel *model);
+int dirmodel_getloadfd(struct dirmodel *model);
+bool dirmodel_isloading(struct dirmodel *model);
+bool dirmodel_isopen(struct dirmodel *model);
 void dirmodel_init(struct dirmodel *model);
 void dirmodel_destroy(struct dirmodel *model);
 
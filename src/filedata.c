@@ -1,10 +1,15 @@
 /* See LICENSE file for copyright and license details. */
 #include "filedata.h"
 
+#include "arena.h"
+
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <locale.h>
 #include <pwd.h>
 #include <grp.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -20,113 +25,117 @@
 #define INFO_DIR              L"<DIR>"
 #define INFO_SIZE_OVERFLOW    L">9000"
 
-int filedata_listcompare_filename(const void *a, const void *b)
-{
-	struct filedata *filedata1 = *(struct filedata **)a;
-	struct filedata *filedata2 = *(struct filedata **)b;
+/* Sort keys longer than this are not stored and such entries are compared
+ * with strcoll() instead, which yields the same order. */
+#define SORT_KEY_MAX 1024
 
-	return strcmp(filedata1->filename, filedata2->filename);
-}
+static bool collate_bytes = true;
 
-int filedata_listcompare_directory_filename(const void *a, const void *b)
+/* Has to be called after the locale is set up and before any entries are
+ * created. Under the C or POSIX locale, names are simply compared bytewise. */
+void filedata_init_collation(void)
 {
-	struct filedata *filedata1 = *(struct filedata **)a;
-	struct filedata *filedata2 = *(struct filedata **)b;
+	const char *locale = setlocale(LC_COLLATE, NULL);
 
-	if(!(S_ISDIR(filedata1->stat.st_mode) ^ S_ISDIR(filedata2->stat.st_mode)))
-		return strcoll(filedata1->filename, filedata2->filename);
-	if(S_ISDIR(filedata1->stat.st_mode))
-		return -1;
-	return 1;
+	collate_bytes = locale == NULL || strcmp(locale, "C") == 0 || strcmp(locale, "POSIX") == 0;
 }
 
-int filedata_listcompare_directory_filename_descending(const void *a, const void *b)
+static const char *sort_key(const struct filedata *filedata)
 {
-	struct filedata *filedata1 = *(struct filedata **)a;
-	struct filedata *filedata2 = *(struct filedata **)b;
+	return filedata->filename + filedata->name_length + 1;
+}
 
-	if(!(S_ISDIR(filedata1->stat.st_mode) ^ S_ISDIR(filedata2->stat.st_mode)))
-		return -strcoll(filedata1->filename, filedata2->filename);
-	if(S_ISDIR(filedata1->stat.st_mode))
-		return -1;
-	return 1;
+static int compare_filename(const struct filedata *filedata1, const struct filedata *filedata2)
+{
+	if(filedata1->has_sort_key && filedata2->has_sort_key)
+		return strcmp(sort_key(filedata1), sort_key(filedata2));
+	if(collate_bytes)
+		return strcmp(filedata1->filename, filedata2->filename);
+	return strcoll(filedata1->filename, filedata2->filename);
 }
 
-int filedata_listcompare_directory_size_filename(const void *a, const void *b)
+int filedata_listcompare_directory_filename(const void *a, const void *b)
 {
 	struct filedata *filedata1 = *(struct filedata **)a;
 	struct filedata *filedata2 = *(struct filedata **)b;
 
-	if(!S_ISDIR(filedata1->stat.st_mode) && !S_ISDIR(filedata2->stat.st_mode)) {
-		if(filedata1->stat.st_size < filedata2->stat.st_size)
-			return -1;
-		else if(filedata1->stat.st_size > filedata2->stat.st_size)
-			return 1;
-		return strcoll(filedata1->filename, filedata2->filename);
-	}
-	if(S_ISDIR(filedata1->stat.st_mode) && S_ISDIR(filedata2->stat.st_mode))
-		return strcoll(filedata1->filename, filedata2->filename);
-	if(S_ISDIR(filedata1->stat.st_mode))
+	if(!(S_ISDIR(filedata1->mode) ^ S_ISDIR(filedata2->mode)))
+		return compare_filename(filedata1, filedata2);
+	if(S_ISDIR(filedata1->mode))
 		return -1;
 	return 1;
 }
 
-int filedata_listcompare_directory_size_filename_descending(const void *a, const void *b)
+int filedata_listcompare_directory_filename_descending(const void *a, const void *b)
 {
 	struct filedata *filedata1 = *(struct filedata **)a;
 	struct filedata *filedata2 = *(struct filedata **)b;
 
-	if(!S_ISDIR(filedata1->stat.st_mode) && !S_ISDIR(filedata2->stat.st_mode)) {
-		if(filedata1->stat.st_size < filedata2->stat.st_size)
-			return 1;
-		else if(filedata1->stat.st_size > filedata2->stat.st_size)
-			return -1;
-		return strcoll(filedata1->filename, filedata2->filename);
-	}
-	if(S_ISDIR(filedata1->stat.st_mode) && S_ISDIR(filedata2->stat.st_mode))
-		return strcoll(filedata1->filename, filedata2->filename);
-	if(S_ISDIR(filedata1->stat.st_mode))
+	if(!(S_ISDIR(filedata1->mode) ^ S_ISDIR(filedata2->mode)))
+		return -compare_filename(filedata1, filedata2);
+	if(S_ISDIR(filedata1->mode))
 		return -1;
 	return 1;
 }
 
-int filedata_listcompare_directory_mtime_filename(const void *a, const void *b)
-{
-	struct filedata *filedata1 = *(struct filedata **)a;
-	struct filedata *filedata2 = *(struct filedata **)b;
+/* The size and mtime orders are defined by an integer key, that puts
+ * directories first and has the value to sort by in the lower 63 bits. Only
+ * entries with equal keys are ordered by name. Both directions of each order
+ * are generated from the same template, so that they cannot diverge, and the
+ * comparators are defined by the keys, so that a radix sort over the keys
+ * yields the same order. */
+#define SORT_KEY_FILE      (UINT64_C(1) << 63)
+#define SORT_KEY_VALUE_MAX (SORT_KEY_FILE - 1)
+
+#define DEFINE_SORT_KEY(suffix, value, descending) \
+uint64_t filedata_sortkey_##suffix(const struct filedata *filedata) \
+{ \
+	uint64_t key = value(filedata); \
+	if(descending) \
+		key = SORT_KEY_VALUE_MAX - key; \
+	return S_ISDIR(filedata->mode) ? key : SORT_KEY_FILE | key; \
+} \
+\
+int filedata_listcompare_directory_##suffix(const void *a, const void *b) \
+{ \
+	struct filedata *filedata1 = *(struct filedata **)a; \
+	struct filedata *filedata2 = *(struct filedata **)b; \
+	uint64_t key1 = filedata_sortkey_##suffix(filedata1); \
+	uint64_t key2 = filedata_sortkey_##suffix(filedata2); \
+\
+	if(key1 < key2) \
+		return -1; \
+	else if(key1 > key2) \
+		return 1; \
+	return compare_filename(filedata1, filedata2); \
+}
 
-	if(!(S_ISDIR(filedata1->stat.st_mode) ^ S_ISDIR(filedata2->stat.st_mode))) {
-		if(filedata1->stat.st_mtime < filedata2->stat.st_mtime)
-			return -1;
-		else if(filedata1->stat.st_mtime > filedata2->stat.st_mtime)
-			return 1;
-		return strcoll(filedata1->filename, filedata2->filename);
-	}
-	if(S_ISDIR(filedata1->stat.st_mode))
-		return -1;
-	return 1;
+/* directories are only sorted by name here */
+static uint64_t size_value(const struct filedata *filedata)
+{
+	return S_ISDIR(filedata->mode) ? 0 : (uint64_t)filedata->size;
 }
 
-int filedata_listcompare_directory_mtime_filename_descending(const void *a, const void *b)
+/* times beyond some billion years are clamped, so that the value fits */
+static uint64_t mtime_value(const struct filedata *filedata)
 {
-	struct filedata *filedata1 = *(struct filedata **)a;
-	struct filedata *filedata2 = *(struct filedata **)b;
+	const time_t limit = (time_t)1 << 61;
 
-	if(!(S_ISDIR(filedata1->stat.st_mode) ^ S_ISDIR(filedata2->stat.st_mode))) {
-		if(filedata1->stat.st_mtime < filedata2->stat.st_mtime)
-			return 1;
-		else if(filedata1->stat.st_mtime > filedata2->stat.st_mtime)
-			return -1;
-		return strcoll(filedata1->filename, filedata2->filename);
-	}
-	if(S_ISDIR(filedata1->stat.st_mode))
-		return -1;
-	return 1;
+	if(filedata->mtime >= limit)
+		return SORT_KEY_VALUE_MAX;
+	if(filedata->mtime < -limit)
+		return 0;
+	return (uint64_t)(filedata->mtime + limit);
 }
 
-static char filetype_character(const struct stat *statbuf)
+DEFINE_SORT_KEY(size_filename, size_value, false)
+DEFINE_SORT_KEY(size_filename_descending, size_value, true)
+DEFINE_SORT_KEY(mtime_filename, mtime_value, false)
+DEFINE_SORT_KEY(mtime_filename_descending, mtime_value, true)
+
+static char filetype_character(mode_t mode)
 {
-	switch(statbuf->st_mode & S_IFMT) {
+	switch(mode & S_IFMT) {
 	case S_IFBLK:
 		return 'b';
 	case S_IFCHR:
@@ -169,27 +178,27 @@ void filedata_format_output(const struct filedata *filedata, char *buffer)
 	}
 
 
-	buffer[0] = filetype_character(&filedata->stat);
-	permission_characters(buffer + 1, (filedata->stat.st_mode >> 6) & 7);
-	permission_characters(buffer + 4, (filedata->stat.st_mode >> 3) & 7);
-	permission_characters(buffer + 7,  filedata->stat.st_mode       & 7);
+	buffer[0] = filetype_character(filedata->mode);
+	permission_characters(buffer + 1, (filedata->mode >> 6) & 7);
+	permission_characters(buffer + 4, (filedata->mode >> 3) & 7);
+	permission_characters(buffer + 7,  filedata->mode       & 7);
 	buffer[10] = ' ';
 
 	size_t length = 11;
 
-	struct passwd *passwd = getpwuid(filedata->stat.st_uid);
-	struct group *group = getgrgid(filedata->stat.st_gid);
+	struct passwd *passwd = getpwuid(filedata->uid);
+	struct group *group = getgrgid(filedata->gid);
 	struct tm modification_time;
-	localtime_r(&filedata->stat.st_mtime, &modification_time);
+	localtime_r(&filedata->mtime, &modification_time);
 
 	if(passwd)
 		length += sprintf(buffer + length, "%.32s ", passwd->pw_name);
 	else
-		length += sprintf(buffer + length, "%.32d ", filedata->stat.st_uid);
+		length += sprintf(buffer + length, "%.32d ", filedata->uid);
 	if(group)
 		length += sprintf(buffer + length, "%.32s ", group->gr_name);
 	else
-		length += sprintf(buffer + length, "%.32d ", filedata->stat.st_gid);
+		length += sprintf(buffer + length, "%.32d ", filedata->gid);
 
 	length += strftime(buffer + length, sizeof("1970-01-01 00:00:00"), "%F %T", &modification_time);
 
@@ -230,12 +239,12 @@ static size_t render_info(wchar_t *buffer, struct filedata *filedata)
 			wcscat(buffer, INFO_LINK);
 	}
 
-	if(S_ISDIR(filedata->stat.st_mode))
+	if(S_ISDIR(filedata->mode))
 		wcscat(buffer, INFO_DIR);
 	else {
 		wchar_t size[INFO_SIZE_DIR_LENGTH + 1] = L"? ";
 		if(filedata->is_stat_valid)
-			filesize_to_string(size, filedata->stat.st_size);
+			filesize_to_string(size, filedata->size);
 		swprintf(buffer + wcslen(buffer), sizeof(size)/sizeof(size[0]), L"%5ls", size);
 	}
 
@@ -311,56 +320,216 @@ size_t filedata_format_list_line(struct filedata *filedata, wchar_t *buffer, siz
 	return char_count + info_size;
 }
 
-int filedata_new_from_file(struct filedata **filedata, int dirfd, const char *filename)
+/* Formats just the name for files, of which nothing else is known. */
+size_t filedata_format_name_line(const char *filename, wchar_t *buffer, size_t len, size_t width)
 {
-	struct stat stat;
-	bool valid = true;
+	size_t char_count = render_filename(buffer, len, width, filename);
+	if(char_count > len)
+		return char_count;
 
-	if(fstatat(dirfd, filename, &stat, AT_SYMLINK_NOFOLLOW) != 0) {
-		if(errno == ENOENT)
-			return ENOENT;
-		valid = false;
-		memset(&stat, 0, sizeof(stat));
+	size_t display_count = wcswidth(buffer, len);
+	if(display_count < width) {
+		size_t padlength = width - display_count;
+
+		if(char_count + padlength <= len) {
+			wmemset(&buffer[char_count], L' ', padlength);
+			buffer[char_count + padlength] = L'\0';
+		}
+		char_count += padlength;
+	}
+
+	return char_count;
+}
+
+static size_t filedata_size(const struct filedata *filedata)
+{
+	size_t size = sizeof(struct filedata) + strlen(filedata->filename) + 1;
+
+	if(filedata->has_sort_key)
+		size += strlen(sort_key(filedata)) + 1;
+	return size;
+}
+
+/* Entries can either live on the heap or, if arena is not NULL, in an arena,
+ * from which they have to be deleted again. */
+int filedata_arena_new(struct arena *arena, struct filedata **filedata, const char *filename)
+{
+	char key[SORT_KEY_MAX];
+	size_t name_length = strlen(filename);
+	size_t key_length = 0;
+	bool has_sort_key = false;
+
+	/* the key is computed once here, so that sorting only compares bytes */
+	if(!collate_bytes && name_length <= UCHAR_MAX) {
+		key_length = strxfrm(key, filename, sizeof(key));
+		has_sort_key = key_length < sizeof(key);
 	}
 
-	*filedata = malloc(sizeof(**filedata));
+	size_t size = sizeof(**filedata) + name_length + 1;
+	if(has_sort_key)
+		size += key_length + 1;
+
+	if(arena)
+		*filedata = arena_alloc(arena, size);
+	else
+		*filedata = malloc(size);
 	if(*filedata == NULL)
 		return ENOMEM;
 
-	(*filedata)->filename = strdup(filename);
-	if((*filedata)->filename == NULL) {
-		free(*filedata);
-		*filedata = NULL;
+	memcpy((*filedata)->filename, filename, name_length + 1);
+	(*filedata)->name_length = has_sort_key ? name_length : 0;
+	(*filedata)->has_sort_key = has_sort_key;
+	if(has_sort_key)
+		memcpy((*filedata)->filename + name_length + 1, key, key_length + 1);
+	(*filedata)->size = 0;
+	(*filedata)->mtime = 0;
+	(*filedata)->uid = 0;
+	(*filedata)->gid = 0;
+	(*filedata)->mode = 0;
+	(*filedata)->link_size = 0;
+	(*filedata)->is_marked = false;
+	(*filedata)->is_stat_valid = false;
+	(*filedata)->is_stat_pending = true;
+	(*filedata)->is_hidden = false;
+	(*filedata)->is_link = false;
+	(*filedata)->is_link_broken = false;
+
+	return 0;
+}
+
+int filedata_new(struct filedata **filedata, const char *filename)
+{
+	return filedata_arena_new(NULL, filedata, filename);
+}
+
+int filedata_arena_copy(struct arena *arena, struct filedata **copy, const struct filedata *filedata)
+{
+	size_t size = filedata_size(filedata);
+
+	*copy = arena_alloc(arena, size);
+	if(*copy == NULL)
 		return ENOMEM;
+
+	memcpy(*copy, filedata, size);
+	return 0;
+}
+
+static int lstat_file(int dirfd, const char *filename, struct stat *stat, bool *valid)
+{
+	*valid = true;
+	if(fstatat(dirfd, filename, stat, AT_SYMLINK_NOFOLLOW) != 0) {
+		if(errno == ENOENT)
+			return ENOENT;
+		*valid = false;
+		memset(stat, 0, sizeof(*stat));
 	}
+	return 0;
+}
 
-	(*filedata)->is_marked = false;
-	(*filedata)->is_stat_valid = valid;
-
-	if(S_ISLNK(stat.st_mode)) {
-		(*filedata)->is_link = true;
-		(*filedata)->link_size = stat.st_size;
-		if(fstatat(dirfd, (*filedata)->filename, &(*filedata)->stat, 0) != 0) {
-			(*filedata)->is_link_broken = true;
-			memcpy(&(*filedata)->stat, &stat, sizeof(stat));
-		} else
-			(*filedata)->is_link_broken = false;
+void filedata_set_stat(struct filedata *filedata, const struct stat *lstat, bool valid, const struct stat *target)
+{
+	const struct stat *stat = lstat;
+
+	filedata->is_stat_valid = valid;
+	filedata->is_stat_pending = false;
+
+	if(S_ISLNK(lstat->st_mode)) {
+		filedata->is_link = true;
+		/* the size of a link is the length of its target path */
+		filedata->link_size = lstat->st_size > USHRT_MAX ? USHRT_MAX : lstat->st_size;
+		filedata->is_link_broken = (target == NULL);
+		if(target)
+			stat = target;
 	} else {
-		(*filedata)->is_link = false;
-		memcpy(&(*filedata)->stat, &stat, sizeof(stat));
+		filedata->is_link = false;
+		filedata->is_link_broken = false;
+		filedata->link_size = 0;
 	}
 
+	filedata->mode = stat->st_mode;
+	filedata->mtime = stat->st_mtime;
+	filedata->uid = stat->st_uid;
+	filedata->gid = stat->st_gid;
+
 	/* st_size field is not used for directories, so zero it out to get
 	 * better file size count statistics in dirmodel */
-	if(S_ISDIR((*filedata)->stat.st_mode))
-		(*filedata)->stat.st_size = 0;
+	if(S_ISDIR(stat->st_mode))
+		filedata->size = 0;
+	else
+		filedata->size = stat->st_size;
+}
+
+/* Takes over the stat data of another entry for the same file, leaving the
+ * name and the mark alone. */
+void filedata_copy_stat(struct filedata *filedata, const struct filedata *source)
+{
+	filedata->size = source->size;
+	filedata->mtime = source->mtime;
+	filedata->uid = source->uid;
+	filedata->gid = source->gid;
+	filedata->mode = source->mode;
+	filedata->link_size = source->link_size;
+	filedata->is_link = source->is_link;
+	filedata->is_link_broken = source->is_link_broken;
+	filedata->is_stat_valid = source->is_stat_valid;
+	filedata->is_stat_pending = source->is_stat_pending;
+}
+
+static void fill_from_lstat(struct filedata *filedata, int dirfd, const struct stat *stat, bool valid)
+{
+	struct stat target;
+
+	if(S_ISLNK(stat->st_mode) && fstatat(dirfd, filedata->filename, &target, 0) == 0)
+		filedata_set_stat(filedata, stat, valid, &target);
+	else
+		filedata_set_stat(filedata, stat, valid, NULL);
+}
+
+int filedata_stat(struct filedata *filedata, int dirfd)
+{
+	struct stat stat;
+	bool valid;
+
+	if(lstat_file(dirfd, filedata->filename, &stat, &valid) != 0)
+		return ENOENT;
+
+	fill_from_lstat(filedata, dirfd, &stat, valid);
 	return 0;
 }
 
-void filedata_delete(struct filedata *filedata)
+int filedata_arena_new_from_file(struct arena *arena, struct filedata **filedata, int dirfd, const char *filename)
+{
+	struct stat stat;
+	bool valid;
+
+	if(lstat_file(dirfd, filename, &stat, &valid) != 0)
+		return ENOENT;
+
+	int ret = filedata_arena_new(arena, filedata, filename);
+	if(ret != 0)
+		return ret;
+
+	fill_from_lstat(*filedata, dirfd, &stat, valid);
+	return 0;
+}
+
+int filedata_new_from_file(struct filedata **filedata, int dirfd, const char *filename)
+{
+	return filedata_arena_new_from_file(NULL, filedata, dirfd, filename);
+}
+
+void filedata_arena_delete(struct arena *arena, struct filedata *filedata)
 {
 	if(filedata == NULL)
 		return;
-	free((void *)filedata->filename);
+
+	if(arena)
+		arena_free(arena, filedata, filedata_size(filedata));
+	else
+		free(filedata);
+}
+
+void filedata_delete(struct filedata *filedata)
+{
 	free(filedata);
 }
@@ -4,33 +4,65 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <sys/stat.h>
+#include <sys/types.h>
 
+struct arena;
+
+/* Only the parts of struct stat, that are actually shown or sorted by, are
+ * kept, and the name is stored inline, so that an entry needs a single
+ * allocation of 32 bytes plus its name. For links, the fields describe the
+ * target, if it exists. Unless the C locale is in effect, the name is followed
+ * by its strxfrm() sort key, which starts name_length + 1 bytes after it. */
 struct filedata {
-	const char *filename;
-	bool is_link;
-	bool is_link_broken;
-	struct stat stat;
-	off_t link_size;
-	bool is_marked;
-	bool is_stat_valid;
+	off_t size;
+	time_t mtime;
+	uid_t uid;
+	gid_t gid;
+	mode_t mode;
+	unsigned short link_size;
+	unsigned char name_length;
+	bool has_sort_key : 1;
+	bool is_link : 1;
+	bool is_link_broken : 1;
+	bool is_marked : 1;
+	bool is_stat_valid : 1;
+	bool is_stat_pending : 1;
+	/* kept by dirmodel, but not shown because of its filter */
+	bool is_hidden : 1;
+	char filename[];
 };
 
-int filedata_listcompare_filename(const void *a, const void *b);
+void filedata_init_collation(void);
+
 int filedata_listcompare_directory_filename(const void *a, const void *b);
 int filedata_listcompare_directory_filename_descending(const void *a, const void *b);
 int filedata_listcompare_directory_size_filename(const void *a, const void *b);
 int filedata_listcompare_directory_size_filename_descending(const void *a, const void *b);
 int filedata_listcompare_directory_mtime_filename(const void *a, const void *b);
 int filedata_listcompare_directory_mtime_filename_descending(const void *a, const void *b);
+uint64_t filedata_sortkey_size_filename(const struct filedata *filedata);
+uint64_t filedata_sortkey_size_filename_descending(const struct filedata *filedata);
+uint64_t filedata_sortkey_mtime_filename(const struct filedata *filedata);
+uint64_t filedata_sortkey_mtime_filename_descending(const struct filedata *filedata);
 
 #define FILEDATA_FORMAT_OUTPUT_BUFFER_SIZE (sizeof("drwxrwxrwx 1970-01-01 00:00:00") + 2 * 33)
 #define INFO_SIZE_DIR_LENGTH  5
 void filedata_format_output(const struct filedata *filedata, char *buffer);
 size_t filedata_format_list_line(struct filedata *filedata, wchar_t *buffer, size_t len, size_t width);
+size_t filedata_format_name_line(const char *filename, wchar_t *buffer, size_t len, size_t width);
 void filesize_to_string(wchar_t *buf, off_t filesize);
 
+int filedata_new(struct filedata **filedata, const char *filename);
+int filedata_arena_new(struct arena *arena, struct filedata **filedata, const char *filename);
+int filedata_arena_copy(struct arena *arena, struct filedata **copy, const struct filedata *filedata);
+int filedata_stat(struct filedata *filedata, int dirfd);
+void filedata_set_stat(struct filedata *filedata, const struct stat *lstat, bool valid, const struct stat *target);
+void filedata_copy_stat(struct filedata *filedata, const struct filedata *source);
 int filedata_new_from_file(struct filedata **filedata, int dirfd, const char *filename);
+int filedata_arena_new_from_file(struct arena *arena, struct filedata **filedata, int dirfd, const char *filename);
 void filedata_delete(struct filedata *filedata);
+void filedata_arena_delete(struct arena *arena, struct filedata *filedata);
 
 #endif
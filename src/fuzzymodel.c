@@ -0,0 +1,399 @@
+/* See LICENSE file for copyright and license details. */
+#include "fuzzymodel.h"
+
+#include "dirmodel.h"
+#include "filedata.h"
+#include "listmodel_impl.h"
+#include "ostree.h"
+#include "util.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FUZZYMODEL_MAX_THREADS 16
+/* scoring a name takes a few nanoseconds, so a thread needs quite some of
+ * them to be worth starting */
+#define FUZZYMODEL_MIN_ITEMS_PER_THREAD 16384
+
+#define SCORE_NO_MATCH    INT_MIN
+#define SCORE_MATCH       16
+#define SCORE_WORD_START  8
+#define SCORE_CONSECUTIVE 4
+#define SCORE_GAP         -1
+
+struct fuzzymodel_worker {
+	const char *query;
+	const struct fuzzymodel_candidate *candidates;
+	int *scores;
+	size_t start;
+	size_t end;
+	/* the best results of this worker with the worst one on top */
+	struct fuzzymodel_result *heap;
+	size_t heap_length;
+};
+
+static inline char fold(char c)
+{
+	return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+static bool is_word_start(const char *name, const char *c)
+{
+	if(c == name)
+		return true;
+	if(strchr(" ._-", c[-1]))
+		return true;
+	return c[-1] >= 'a' && c[-1] <= 'z' && *c >= 'A' && *c <= 'Z';
+}
+
+/* Matches the query characters at their first occurrence. Matches at the
+ * start of a word and runs of matching characters count more, characters
+ * skipped between matches count less. */
+static int score_name(const char *query, const char *name)
+{
+	const char *first = query;
+	int score = 0;
+	bool previous_matched = false;
+
+	for(const char *c = name; *c && *query; c++) {
+		if(fold(*c) == *query) {
+			score += SCORE_MATCH;
+			if(is_word_start(name, c))
+				score += SCORE_WORD_START;
+			if(previous_matched)
+				score += SCORE_CONSECUTIVE;
+			previous_matched = true;
+			query++;
+		} else {
+			if(query != first)
+				score += SCORE_GAP;
+			previous_matched = false;
+		}
+	}
+	return *query ? SCORE_NO_MATCH : score;
+}
+
+static bool is_worse(const struct fuzzymodel_result *a, const struct fuzzymodel_result *b)
+{
+	return a->score < b->score || (a->score == b->score && a->position > b->position);
+}
+
+static void heap_push(struct fuzzymodel_result *heap, size_t *length, const struct fuzzymodel_result *result)
+{
+	size_t i;
+
+	if(*length < FUZZYMODEL_MAX_RESULTS) {
+		for(i = (*length)++; i > 0 && is_worse(result, &heap[(i - 1) / 2]); i = (i - 1) / 2)
+			heap[i] = heap[(i - 1) / 2];
+		heap[i] = *result;
+		return;
+	}
+
+	if(!is_worse(&heap[0], result))
+		return;
+
+	for(i = 0; 2 * i + 1 < *length;) {
+		size_t child = 2 * i + 1;
+		if(child + 1 < *length && is_worse(&heap[child + 1], &heap[child]))
+			child++;
+		if(!is_worse(&heap[child], result))
+			break;
+		heap[i] = heap[child];
+		i = child;
+	}
+	heap[i] = *result;
+}
+
+static void *fuzzymodel_worker(void *data)
+{
+	struct fuzzymodel_worker *worker = data;
+
+	for(size_t i = worker->start; i < worker->end; i++) {
+		const struct fuzzymodel_candidate *candidate = &worker->candidates[i];
+
+		worker->scores[i] = score_name(worker->query, candidate->name);
+		if(worker->scores[i] == SCORE_NO_MATCH)
+			continue;
+
+		struct fuzzymodel_result result = {
+			.name = candidate->name,
+			.position = candidate->position,
+			.score = worker->scores[i],
+		};
+		heap_push(worker->heap, &worker->heap_length, &result);
+	}
+	return NULL;
+}
+
+static unsigned int thread_count(const struct fuzzymodel *model)
+{
+	unsigned int threads = model->threads;
+
+	if(threads > FUZZYMODEL_MAX_THREADS)
+		threads = FUZZYMODEL_MAX_THREADS;
+	if(threads > model->candidate_count / FUZZYMODEL_MIN_ITEMS_PER_THREAD)
+		threads = model->candidate_count / FUZZYMODEL_MIN_ITEMS_PER_THREAD;
+	return threads > 0 ? threads : 1;
+}
+
+/* Splits the candidates into one range per thread, each with room for
+ * FUZZYMODEL_MAX_RESULTS in heaps. Ranges of threads, that fail to start,
+ * are scored by the calling thread. */
+static void score_with_threads(struct fuzzymodel *model, const char *query, int *scores,
+		struct fuzzymodel_result *heaps, struct fuzzymodel_worker *workers, unsigned int threads)
+{
+	size_t count = model->candidate_count;
+
+	for(unsigned int i = 0; i < threads; i++) {
+		workers[i].query = query;
+		workers[i].candidates = model->candidates;
+		workers[i].scores = scores;
+		workers[i].start = count * i / threads;
+		workers[i].end = count * (i + 1) / threads;
+		workers[i].heap = &heaps[(size_t)i * FUZZYMODEL_MAX_RESULTS];
+		workers[i].heap_length = 0;
+	}
+
+	pthread_t thread_ids[FUZZYMODEL_MAX_THREADS];
+	bool started[FUZZYMODEL_MAX_THREADS] = { false };
+	for(unsigned int i = 1; i < threads; i++)
+		started[i] = pthread_create(&thread_ids[i], NULL, fuzzymodel_worker, &workers[i]) == 0;
+	for(unsigned int i = 0; i < threads; i++)
+		if(!started[i])
+			fuzzymodel_worker(&workers[i]);
+	for(unsigned int i = 1; i < threads; i++)
+		if(started[i])
+			pthread_join(thread_ids[i], NULL);
+}
+
+static int compare_results(const void *a, const void *b)
+{
+	const struct fuzzymodel_result *result1 = a;
+	const struct fuzzymodel_result *result2 = b;
+
+	if(is_worse(result2, result1))
+		return -1;
+	return is_worse(result1, result2);
+}
+
+/* The query matches a subset of the names, that the previous one matched,
+ * if it contains the previous one's characters in the same order. */
+static bool is_subsequence(const char *previous, const char *query)
+{
+	for(; *previous && *query; query++)
+		if(*previous == *query)
+			previous++;
+	return *previous == '\0';
+}
+
+static int collect_candidates(struct fuzzymodel *model)
+{
+	struct dirmodel *source = model->source;
+	size_t count = listmodel_count(&source->listmodel);
+	struct ostree_cursor cursor;
+
+	struct fuzzymodel_candidate *candidates = malloc((count > 0 ? count : 1) * sizeof(candidates[0]));
+	if(candidates == NULL)
+		return ENOMEM;
+
+	if(count > 0) {
+		struct filedata *filedata = ostree_seek(source->sortedlist, 0, &cursor);
+		for(size_t i = 0; filedata; i++, filedata = ostree_next(&cursor)) {
+			candidates[i].name = filedata->filename;
+			candidates[i].position = i;
+		}
+	}
+
+	free(model->candidates);
+	model->candidates = candidates;
+	model->candidate_count = count;
+	model->candidates_valid = true;
+	model->source_generation = source->generation;
+	return 0;
+}
+
+/* Copies the best results together with their names. */
+static int take_results(struct fuzzymodel *model, struct fuzzymodel_result *heaps,
+		const struct fuzzymodel_worker *workers, unsigned int threads)
+{
+	size_t count = 0, names_size = 0;
+
+	for(unsigned int i = 0; i < threads; i++) {
+		memmove(&heaps[count], workers[i].heap, workers[i].heap_length * sizeof(heaps[0]));
+		count += workers[i].heap_length;
+	}
+	qsort(heaps, count, sizeof(heaps[0]), compare_results);
+	if(count > FUZZYMODEL_MAX_RESULTS)
+		count = FUZZYMODEL_MAX_RESULTS;
+
+	for(size_t i = 0; i < count; i++)
+		names_size += strlen(heaps[i].name) + 1;
+
+	struct fuzzymodel_result *results = malloc((count > 0 ? count : 1) * sizeof(results[0]));
+	if(results == NULL)
+		return ENOMEM;
+	char *names = malloc(names_size > 0 ? names_size : 1);
+	if(names == NULL) {
+		free(results);
+		return ENOMEM;
+	}
+
+	char *name = names;
+	for(size_t i = 0; i < count; i++) {
+		size_t size = strlen(heaps[i].name) + 1;
+		results[i] = heaps[i];
+		results[i].name = memcpy(name, heaps[i].name, size);
+		name += size;
+	}
+
+	free(model->results);
+	free(model->names);
+	model->results = results;
+	model->result_count = count;
+	model->names = names;
+	return 0;
+}
+
+/* Scores the names against query on multiple threads. As long as the query
+ * only gets more characters, only the names, that matched before, are
+ * scored again. */
+int fuzzymodel_setquery(struct fuzzymodel *model, const char *query)
+{
+	int ret = ENOMEM;
+	size_t length = strlen(query);
+
+	char *folded = malloc(length + 1);
+	if(folded == NULL)
+		return ENOMEM;
+	for(size_t i = 0; i <= length; i++)
+		folded[i] = fold(query[i]);
+
+	if(!model->candidates_valid || model->source_generation != model->source->generation ||
+			model->query == NULL || !is_subsequence(model->query, folded)) {
+		ret = collect_candidates(model);
+		if(ret != 0)
+			goto err_folded;
+		ret = ENOMEM;
+	}
+
+	size_t count = model->candidate_count;
+	int *scores = malloc((count > 0 ? count : 1) * sizeof(scores[0]));
+	if(scores == NULL)
+		goto err_folded;
+	unsigned int threads = thread_count(model);
+	struct fuzzymodel_result *heaps = malloc(threads * FUZZYMODEL_MAX_RESULTS * sizeof(heaps[0]));
+	if(heaps == NULL)
+		goto err_scores;
+
+	struct fuzzymodel_worker workers[FUZZYMODEL_MAX_THREADS];
+	score_with_threads(model, folded, scores, heaps, workers, threads);
+	if(take_results(model, heaps, workers, threads) != 0)
+		goto err_heaps;
+
+	/* only the names, that matched, can match a longer query */
+	size_t kept = 0;
+	for(size_t i = 0; i < count; i++)
+		if(scores[i] != SCORE_NO_MATCH)
+			model->candidates[kept++] = model->candidates[i];
+	model->candidate_count = kept;
+
+	free(model->query);
+	model->query = folded;
+	free(heaps);
+	free(scores);
+
+	listmodel_notify_change(&model->listmodel, MODEL_RELOAD, 0, 0);
+	return 0;
+
+err_heaps:
+	free(heaps);
+err_scores:
+	free(scores);
+err_folded:
+	free(folded);
+	return ret;
+}
+
+const char *fuzzymodel_getfilename(struct fuzzymodel *model, size_t index)
+{
+	return model->results[index].name;
+}
+
+static size_t fuzzymodel_count(struct listmodel *listmodel)
+{
+	struct fuzzymodel *model = container_of(listmodel, struct fuzzymodel, listmodel);
+	return model->result_count;
+}
+
+/* Files, that are still there, look like in the listing. */
+static size_t fuzzymodel_render(struct listmodel *listmodel, wchar_t *buffer, size_t len, size_t width, size_t index)
+{
+	struct fuzzymodel *model = container_of(listmodel, struct fuzzymodel, listmodel);
+	const char *name = model->results[index].name;
+	size_t source_index;
+
+	if(dirmodel_get_index(model->source, name, &source_index))
+		return listmodel_render(&model->source->listmodel, buffer, len, width, source_index);
+	return filedata_format_name_line(name, buffer, len, width);
+}
+
+static bool fuzzymodel_ismarked(struct listmodel *listmodel, size_t index)
+{
+	struct fuzzymodel *model = container_of(listmodel, struct fuzzymodel, listmodel);
+	size_t source_index;
+
+	if(!dirmodel_get_index(model->source, model->results[index].name, &source_index))
+		return false;
+	return listmodel_ismarked(&model->source->listmodel, source_index);
+}
+
+static void source_changed(enum model_change change, size_t newindex, size_t oldindex, void *data)
+{
+	struct fuzzymodel *model = data;
+	(void)change;
+	(void)newindex;
+	(void)oldindex;
+
+	model->candidates_valid = false;
+}
+
+bool fuzzymodel_init(struct fuzzymodel *model, struct dirmodel *source)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	listmodel_init(&model->listmodel);
+	model->listmodel.count = fuzzymodel_count;
+	model->listmodel.render = fuzzymodel_render;
+	model->listmodel.setmark = NULL;
+	model->listmodel.ismarked = fuzzymodel_ismarked;
+	model->source = source;
+	model->query = NULL;
+	model->candidates = NULL;
+	model->candidate_count = 0;
+	model->candidates_valid = false;
+	model->source_generation = 0;
+	model->results = NULL;
+	model->result_count = 0;
+	model->names = NULL;
+	model->threads = cpus < 1 ? 1 : cpus;
+
+	if(!listmodel_register_change_callback(&source->listmodel, source_changed, model)) {
+		listmodel_destroy(&model->listmodel);
+		return false;
+	}
+	return true;
+}
+
+void fuzzymodel_destroy(struct fuzzymodel *model)
+{
+	listmodel_unregister_change_callback(&model->source->listmodel, source_changed, model);
+	listmodel_destroy(&model->listmodel);
+	free(model->query);
+	free(model->candidates);
+	free(model->results);
+	free(model->names);
+}
@@ -0,0 +1,54 @@
+/* See LICENSE file for copyright and license details. */
+#ifndef FUZZYMODEL_H
+#define FUZZYMODEL_H
+
+#include "listmodel.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct dirmodel;
+
+/* at most this many of the best matches are shown */
+#define FUZZYMODEL_MAX_RESULTS 1024
+
+struct fuzzymodel_candidate {
+	const char *name;
+	/* position in the listing, which decides between equal scores */
+	size_t position;
+};
+
+struct fuzzymodel_result {
+	const char *name;
+	size_t position;
+	int score;
+};
+
+/* Lists the entries of a dirmodel, whose names contain the characters of a
+ * query in the same order, best matches first. */
+struct fuzzymodel {
+	struct listmodel listmodel;
+	struct dirmodel *source;
+	/* the folded query, that the results belong to */
+	char *query;
+	/* entries of source, that match query and that the next query is
+	 * scored against, as long as it only adds characters to this one;
+	 * they point into source and are dropped on any change of it or when
+	 * its entries move, which changes its generation */
+	struct fuzzymodel_candidate *candidates;
+	size_t candidate_count;
+	bool candidates_valid;
+	unsigned long source_generation;
+	/* the names are copied, so that they survive changes of source */
+	struct fuzzymodel_result *results;
+	size_t result_count;
+	char *names;
+	unsigned int threads;
+};
+
+int fuzzymodel_setquery(struct fuzzymodel *model, const char *query) __attribute__((warn_unused_result));
+const char *fuzzymodel_getfilename(struct fuzzymodel *model, size_t index);
+bool fuzzymodel_init(struct fuzzymodel *model, struct dirmodel *source) __attribute__((warn_unused_result));
+void fuzzymodel_destroy(struct fuzzymodel *model);
+
+#endif
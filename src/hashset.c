@@ -0,0 +1,146 @@
+/* See LICENSE file for copyright and license details. */
+#include "hashset.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HASHSET_MIN_SIZE 16
+
+/* FNV-1a */
+size_t hashset_hash(const char *string)
+{
+	uint64_t hash = UINT64_C(14695981039346656037);
+
+	for(; *string; string++) {
+		hash ^= (unsigned char)*string;
+		hash *= UINT64_C(1099511628211);
+	}
+	return hash;
+}
+
+/* Returns the slot, that holds the item with key, or the empty slot, where
+ * it would go. The set must have at least one empty slot. */
+static size_t find_slot(const struct hashset *set, const char *key)
+{
+	size_t mask = set->size - 1;
+	size_t i = hashset_hash(key) & mask;
+
+	while(set->slots[i] && strcmp(set->key(set->slots[i]), key) != 0)
+		i = (i + 1) & mask;
+	return i;
+}
+
+static bool hashset_resize(struct hashset *set, size_t size)
+{
+	void **slots = malloc(size * sizeof(slots[0]));
+	if(slots == NULL)
+		return false;
+	memset(slots, 0, size * sizeof(slots[0]));
+
+	void **oldslots = set->slots;
+	size_t oldsize = set->size;
+
+	set->slots = slots;
+	set->size = size;
+	for(size_t i = 0; i < oldsize; i++)
+		if(oldslots[i])
+			set->slots[find_slot(set, set->key(oldslots[i]))] = oldslots[i];
+
+	free(oldslots);
+	return true;
+}
+
+void hashset_init(struct hashset *set, const char *(*key)(const void *item))
+{
+	set->slots = NULL;
+	set->size = 0;
+	set->length = 0;
+	set->key = key;
+}
+
+void hashset_destroy(struct hashset *set, list_item_deallocator deallocator)
+{
+	if(deallocator)
+		for(size_t i = 0; i < set->size; i++)
+			if(set->slots[i])
+				deallocator(set->slots[i]);
+	free(set->slots);
+	hashset_init(set, set->key);
+}
+
+size_t hashset_length(const struct hashset *set)
+{
+	return set->length;
+}
+
+/* The set must not contain an item with the same key yet. */
+bool hashset_insert(struct hashset *set, void *item)
+{
+	/* keep a quarter of the slots empty, so that probing stays short */
+	if((set->length + 1) * 4 > set->size * 3)
+		if(!hashset_resize(set, set->size ? set->size * 2 : HASHSET_MIN_SIZE))
+			return false;
+
+	size_t i = find_slot(set, set->key(item));
+	assert(set->slots[i] == NULL);
+	set->slots[i] = item;
+	set->length++;
+	return true;
+}
+
+/* Removes the item with key and returns it, or NULL, if there is none. */
+void *hashset_remove(struct hashset *set, const char *key)
+{
+	if(set->length == 0)
+		return NULL;
+
+	size_t mask = set->size - 1;
+	size_t hole = find_slot(set, key);
+	void *item = set->slots[hole];
+	if(item == NULL)
+		return NULL;
+
+	/* instead of leaving a marker, close the hole with the following items
+	 * of the probe sequence, that are allowed to move there */
+	for(size_t i = (hole + 1) & mask; set->slots[i]; i = (i + 1) & mask) {
+		size_t home = hashset_hash(set->key(set->slots[i])) & mask;
+		if(((i - home) & mask) >= ((i - hole) & mask)) {
+			set->slots[hole] = set->slots[i];
+			hole = i;
+		}
+	}
+	set->slots[hole] = NULL;
+	set->length--;
+	return item;
+}
+
+void *hashset_get(const struct hashset *set, const char *key)
+{
+	if(set->length == 0)
+		return NULL;
+	return set->slots[find_slot(set, key)];
+}
+
+/* Puts item in place of the one with the same key, which must exist, and
+ * returns the replaced one. */
+void *hashset_replace(struct hashset *set, void *item)
+{
+	size_t i = find_slot(set, set->key(item));
+	void *old = set->slots[i];
+
+	assert(old != NULL);
+	set->slots[i] = item;
+	return old;
+}
+
+/* Returns the next item in no particular order, starting with *position set
+ * to 0, or NULL after the last one. */
+void *hashset_next(const struct hashset *set, size_t *position)
+{
+	for(; *position < set->size; (*position)++)
+		if(set->slots[*position])
+			return set->slots[(*position)++];
+	return NULL;
+}
@@ -0,0 +1,30 @@
+/* See LICENSE file for copyright and license details. */
+#ifndef HASHSET_H
+#define HASHSET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "list.h"
+
+/* A set of items, that are found by a string key, which is part of the item
+ * itself, so that no extra memory per item is needed besides its slot. */
+struct hashset {
+	void **slots;
+	size_t size;
+	size_t length;
+	const char *(*key)(const void *item);
+};
+
+void hashset_init(struct hashset *set, const char *(*key)(const void *item));
+void hashset_destroy(struct hashset *set, list_item_deallocator deallocator);
+
+size_t hashset_hash(const char *string);
+size_t hashset_length(const struct hashset *set);
+bool hashset_insert(struct hashset *set, void *item) __attribute__((warn_unused_result));
+void *hashset_remove(struct hashset *set, const char *key);
+void *hashset_get(const struct hashset *set, const char *key);
+void *hashset_replace(struct hashset *set, void *item);
+void *hashset_next(const struct hashset *set, size_t *position);
+
+#endif
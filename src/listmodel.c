@@ -34,6 +34,30 @@ bool listmodel_ismarked(struct listmodel *model, size_t index)
 		return false;
 }
 
+void listmodel_prefetch(struct listmodel *model, size_t index, size_t count)
+{
+	if(model->prefetch)
+		model->prefetch(model, index, count);
+}
+
+/* Only valid while a MODEL_ADD_BATCH notification is delivered. */
+size_t listmodel_added_before(struct listmodel *model, size_t oldindex)
+{
+	if(model->added_before)
+		return model->added_before(model, oldindex);
+	else
+		return 0;
+}
+
+/* Only valid while a MODEL_REMOVE_BATCH notification is delivered. */
+size_t listmodel_removed_before(struct listmodel *model, size_t oldindex)
+{
+	if(model->removed_before)
+		return model->removed_before(model, oldindex);
+	else
+		return 0;
+}
+
 bool listmodel_register_change_callback(struct listmodel *model, model_change_callback callback, void *data)
 {
 	if(model->change_callbacks == NULL)
@@ -89,6 +113,9 @@ void listmodel_notify_change(struct listmodel *model, enum model_change change,
 
 void listmodel_init(struct listmodel *model)
 {
+	model->prefetch = NULL;
+	model->added_before = NULL;
+	model->removed_before = NULL;
 	model->change_callbacks = NULL;
 }
 
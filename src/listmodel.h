@@ -12,6 +12,9 @@ struct listmodel {
 	size_t (*render)(struct listmodel *model, wchar_t *buffer, size_t len, size_t width, size_t index);
 	void (*setmark)(struct listmodel *model, size_t index, bool mark);
 	bool (*ismarked)(struct listmodel *model, size_t index);
+	void (*prefetch)(struct listmodel *model, size_t index, size_t count);
+	size_t (*added_before)(struct listmodel *model, size_t oldindex);
+	size_t (*removed_before)(struct listmodel *model, size_t oldindex);
 	struct list *change_callbacks;
 };
 
@@ -20,6 +23,14 @@ enum model_change {
 	MODEL_REMOVE,
 	MODEL_CHANGE,
 	MODEL_RELOAD,
+	/* several entries were added at once, newindex is the first of them and
+	 * oldindex their count, listmodel_added_before tells, how many went
+	 * before an entry, that was there before */
+	MODEL_ADD_BATCH,
+	/* several entries were removed at once, oldindex is their count and
+	 * listmodel_removed_before tells, how many of them were before an
+	 * index */
+	MODEL_REMOVE_BATCH,
 };
 
 typedef void(model_change_callback)(enum model_change change, size_t newindex, size_t oldindex, void *data);
@@ -28,6 +39,9 @@ size_t listmodel_count(struct listmodel *model);
 size_t listmodel_render(struct listmodel *model, wchar_t *buffer, size_t len, size_t width, size_t index);
 void listmodel_setmark(struct listmodel *model, size_t index, bool mark);
 bool listmodel_ismarked(struct listmodel *model, size_t index);
+void listmodel_prefetch(struct listmodel *model, size_t index, size_t count);
+size_t listmodel_added_before(struct listmodel *model, size_t oldindex);
+size_t listmodel_removed_before(struct listmodel *model, size_t oldindex);
 bool listmodel_register_change_callback(struct listmodel *model, model_change_callback callback, void *data) __attribute__((warn_unused_result));
 void listmodel_unregister_change_callback(struct listmodel *model, model_change_callback callback, void *data);
 
@@ -6,6 +6,10 @@
 #include <ncurses.h>
 #include <wchar.h>
 
+/* number of rows above and below the visible window, that are prefetched, so
+ * that scrolling by a page does not stall on rows, that were not prepared */
+#define LISTVIEW_PREFETCH_PAGES 1
+
 static int attrs_for_index(struct listmodel *model, size_t index, size_t selected)
 {
 	if(index == selected) {
@@ -32,6 +36,15 @@ void listview_refresh(struct listview *view)
 
 	size_t buflen = width;
 
+	size_t count = listmodel_count(view->model);
+	size_t margin = (size_t)height * LISTVIEW_PREFETCH_PAGES;
+	size_t prefetch_first = view->first > margin ? view->first - margin : 0;
+	size_t prefetch_end = view->first + height + margin;
+	if(prefetch_end > count)
+		prefetch_end = count;
+	if(prefetch_first < prefetch_end)
+		listmodel_prefetch(view->model, prefetch_first, prefetch_end - prefetch_first);
+
 	werase(view->window);
 	while(i < height) {
 		if(i + view->first >= listmodel_count(view->model))
@@ -179,6 +192,20 @@ static void change_cb(enum model_change change, size_t newindex, size_t oldindex
 		view->first = 0;
 		view->index = 0;
 		view->needs_refresh = true;
+		break;
+	case MODEL_ADD_BATCH: {
+		size_t shift = listmodel_added_before(view->model, view->index);
+		if(shift > 0)
+			listview_setindex_internal(view, view->index + shift, 1, true);
+		else if(newindex < view->first + rowcount)
+			view->needs_refresh = true;
+		break;
+	}
+	case MODEL_REMOVE_BATCH:
+		/* if the selected entry is gone, the one following it is
+		 * selected, like with MODEL_REMOVE */
+		listview_setindex_internal(view, view->index - listmodel_removed_before(view->model, view->index), 0, true);
+		break;
 	}
 }
 
@@ -1,5 +1,6 @@
 /* See LICENSE file for copyright and license details. */
 #include "application.h"
+#include "filedata.h"
 
 #include <locale.h>
 #include <ncurses.h>
@@ -25,6 +26,7 @@ int main(void)
 	int ret = 0;
 
 	setlocale(LC_ALL, "");
+	filedata_init_collation();
 	tzset();
 	init_ncurses();
 
@@ -0,0 +1,258 @@
+/* See LICENSE file for copyright and license details. */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "matcher.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REGEX_SPECIAL ".[]()*+?{}|^$\\"
+
+static inline char fold(char c)
+{
+	return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+/* Splits the pattern at ".*" into the folded strings in between and returns
+ * their count, or 0, if the pattern needs a real regex. Only ASCII is folded
+ * here, so anything else has to go through regcomp(), which knows the case
+ * rules of the locale. Counts only, if segments and buffer are NULL. */
+static size_t split_pattern(const char *pattern, struct matcher_segment *segments, char *buffer,
+		bool *anchored_start, bool *anchored_end)
+{
+	size_t count = 0, length = 0;
+
+	*anchored_start = *pattern == '^';
+	*anchored_end = false;
+	if(*anchored_start)
+		pattern++;
+
+	for(;; pattern++) {
+		unsigned char c = *pattern;
+		bool end = c == '\0' || (c == '$' && pattern[1] == '\0');
+
+		if(end || (c == '.' && pattern[1] == '*')) {
+			if(segments) {
+				segments[count].string = buffer - length;
+				segments[count].length = length;
+			}
+			count++;
+			length = 0;
+			if(end) {
+				*anchored_end = c == '$';
+				return count;
+			}
+			pattern++;
+			continue;
+		}
+
+		if(c == '\\' && pattern[1] != '\0' && strchr(REGEX_SPECIAL, pattern[1]))
+			c = *++pattern;
+		else if(strchr(REGEX_SPECIAL, c))
+			return 0;
+		if(c < ' ' || c > '~' || length == NAME_MAX)
+			return 0;
+		if(buffer)
+			*buffer++ = fold(c);
+		length++;
+	}
+}
+
+/* ".*" next to an anchor or another ".*" matches anything, so empty strings
+ * can be dropped along with their anchor, as long as one string is left. */
+static void drop_empty_segments(struct matcher *matcher)
+{
+	size_t count = 0;
+
+	if(matcher->segment_count == 1)
+		return;
+
+	if(matcher->segments[0].length == 0)
+		matcher->anchored_start = false;
+	if(matcher->segments[matcher->segment_count - 1].length == 0)
+		matcher->anchored_end = false;
+
+	for(size_t i = 0; i < matcher->segment_count; i++)
+		if(matcher->segments[i].length > 0)
+			matcher->segments[count++] = matcher->segments[i];
+	matcher->segment_count = count > 0 ? count : 1;
+}
+
+static bool equals_folded(const char *name, const struct matcher_segment *segment)
+{
+	for(size_t i = 0; i < segment->length; i++)
+		if(fold(name[i]) != segment->string[i])
+			return false;
+	return true;
+}
+
+static bool equals_segment(const char *text, const struct matcher_segment *segment, bool folded)
+{
+	if(folded)
+		return memcmp(text, segment->string, segment->length) == 0;
+	return equals_folded(text, segment);
+}
+
+static const char *find_segment(const char *text, size_t length, const struct matcher_segment *segment, bool folded)
+{
+	if(folded)
+		return memmem(text, length, segment->string, segment->length);
+
+	for(size_t i = 0; i + segment->length <= length; i++)
+		if(equals_folded(text + i, segment))
+			return text + i;
+	return NULL;
+}
+
+/* Names are folded into a buffer first, so that the strings can be searched
+ * with memmem(), which is vectorized in glibc. Longer names than a file name
+ * can be are compared the slow way. */
+static bool match_segments(const struct matcher *matcher, const char *name)
+{
+	char buffer[NAME_MAX];
+	size_t length = strlen(name);
+	size_t first = 0, last = matcher->segment_count;
+	const struct matcher_segment *segment;
+	bool folded = length <= sizeof(buffer);
+	const char *text = name;
+
+	if(folded) {
+		for(size_t i = 0; i < length; i++)
+			buffer[i] = fold(name[i]);
+		text = buffer;
+	}
+
+	if(matcher->anchored_start) {
+		segment = &matcher->segments[first++];
+		if(segment->length > length || !equals_segment(text, segment, folded))
+			return false;
+		text += segment->length;
+		length -= segment->length;
+	}
+	if(matcher->anchored_end) {
+		segment = &matcher->segments[--last];
+		if(segment->length > length || !equals_segment(text + length - segment->length, segment, folded))
+			return false;
+		length -= segment->length;
+	}
+
+	/* taking the leftmost match of each string leaves the most room for
+	 * the following ones */
+	for(size_t i = first; i < last; i++) {
+		segment = &matcher->segments[i];
+		const char *found = find_segment(text, length, segment, folded);
+		if(found == NULL)
+			return false;
+		length -= found + segment->length - text;
+		text = found + segment->length;
+	}
+	return true;
+}
+
+/* Returns EINVAL for an invalid regular expression. If the matcher could not
+ * be set up, there is nothing to destroy. */
+int matcher_init(struct matcher *matcher, const char *pattern)
+{
+	int ret = ENOMEM;
+
+	matcher->pattern = strdup(pattern);
+	if(matcher->pattern == NULL)
+		return ENOMEM;
+
+	matcher->segments = NULL;
+	matcher->segment_count = split_pattern(pattern, NULL, NULL, &matcher->anchored_start, &matcher->anchored_end);
+	if(matcher->segment_count == 0) {
+		matcher->kind = MATCHER_REGEX;
+		if(regcomp(&matcher->regex, pattern, REG_EXTENDED | REG_ICASE | REG_NOSUB) != 0) {
+			ret = EINVAL;
+			goto err_pattern;
+		}
+		return 0;
+	}
+
+	/* the strings go right behind the array */
+	matcher->segments = malloc(matcher->segment_count * sizeof(matcher->segments[0]) + strlen(pattern));
+	if(matcher->segments == NULL)
+		goto err_pattern;
+	split_pattern(pattern, matcher->segments, (char *)&matcher->segments[matcher->segment_count],
+			&matcher->anchored_start, &matcher->anchored_end);
+	drop_empty_segments(matcher);
+
+	if(matcher->segment_count > 1)
+		matcher->kind = MATCHER_GLOB;
+	else if(matcher->anchored_start)
+		matcher->kind = matcher->anchored_end ? MATCHER_EXACT : MATCHER_PREFIX;
+	else
+		matcher->kind = matcher->anchored_end ? MATCHER_SUFFIX : MATCHER_LITERAL;
+	return 0;
+
+err_pattern:
+	free(matcher->pattern);
+	matcher->pattern = NULL;
+	return ret;
+}
+
+void matcher_destroy(struct matcher *matcher)
+{
+	if(matcher->pattern == NULL)
+		return;
+
+	if(matcher->kind == MATCHER_REGEX)
+		regfree(&matcher->regex);
+	free(matcher->segments);
+	free(matcher->pattern);
+	matcher->pattern = NULL;
+}
+
+bool matcher_match(const struct matcher *matcher, const char *name)
+{
+	const struct matcher_segment *segment = matcher->segments;
+	size_t length;
+
+	switch(matcher->kind) {
+	case MATCHER_PREFIX:
+		return equals_folded(name, segment);
+	case MATCHER_SUFFIX:
+		length = strlen(name);
+		return length >= segment->length && equals_folded(name + length - segment->length, segment);
+	case MATCHER_EXACT:
+		return strlen(name) == segment->length && equals_folded(name, segment);
+	case MATCHER_LITERAL:
+	case MATCHER_GLOB:
+		return match_segments(matcher, name);
+	case MATCHER_REGEX:
+		break;
+	}
+	return regexec(&matcher->regex, name, 0, NULL, 0) == 0;
+}
+
+/* Tells, whether new can only match names, that old matches as well, as far
+ * as this can be seen from the patterns alone. */
+bool matcher_narrows(const struct matcher *old, const struct matcher *new)
+{
+	if(old->kind == MATCHER_REGEX || new->kind == MATCHER_REGEX)
+		return false;
+
+	const struct matcher_segment *string = &old->segments[0];
+	const struct matcher_segment *first = &new->segments[0];
+	const struct matcher_segment *last = &new->segments[new->segment_count - 1];
+
+	switch(old->kind) {
+	case MATCHER_LITERAL:
+		for(size_t i = 0; i < new->segment_count; i++)
+			if(memmem(new->segments[i].string, new->segments[i].length, string->string, string->length))
+				return true;
+		return false;
+	case MATCHER_PREFIX:
+		return new->anchored_start && first->length >= string->length &&
+			memcmp(first->string, string->string, string->length) == 0;
+	case MATCHER_SUFFIX:
+		return new->anchored_end && last->length >= string->length &&
+			memcmp(last->string + last->length - string->length, string->string, string->length) == 0;
+	default:
+		return false;
+	}
+}
@@ -0,0 +1,44 @@
+/* See LICENSE file for copyright and license details. */
+#ifndef MATCHER_H
+#define MATCHER_H
+
+#include <regex.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+enum matcher_kind {
+	MATCHER_LITERAL,
+	MATCHER_PREFIX,
+	MATCHER_SUFFIX,
+	MATCHER_EXACT,
+	MATCHER_GLOB,
+	MATCHER_REGEX,
+};
+
+struct matcher_segment {
+	const char *string;
+	size_t length;
+};
+
+/* A compiled case insensitive regular expression, that is matched against
+ * file names. Expressions, that are only plain strings joined by ".*" and
+ * optionally anchored, are matched by comparing the strings directly,
+ * everything else is handed to regexec(). */
+struct matcher {
+	enum matcher_kind kind;
+	/* the pattern as given, to tell whether it can be reused */
+	char *pattern;
+	/* the folded strings between ".*", at least one unless MATCHER_REGEX */
+	struct matcher_segment *segments;
+	size_t segment_count;
+	bool anchored_start;
+	bool anchored_end;
+	regex_t regex;
+};
+
+int matcher_init(struct matcher *matcher, const char *pattern) __attribute__((warn_unused_result));
+void matcher_destroy(struct matcher *matcher);
+bool matcher_match(const struct matcher *matcher, const char *name);
+bool matcher_narrows(const struct matcher *old, const struct matcher *new);
+
+#endif
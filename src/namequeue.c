@@ -0,0 +1,167 @@
+/* See LICENSE file for copyright and license details. */
+#include "namequeue.h"
+
+#include "hashset.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define NAMEQUEUE_MIN_SIZE 16
+#define NAMEQUEUE_MIN_POOL_SIZE 4096
+/* a round, that used less than this part of the slots, gives the memory of
+ * earlier, bigger ones back, unless there are only a few slots */
+#define NAMEQUEUE_SHRINK_FACTOR 16
+#define NAMEQUEUE_SHRINK_MIN_SIZE 1024
+
+static bool slot_used(const struct namequeue *queue, size_t i)
+{
+	return queue->slots[i].generation == queue->generation;
+}
+
+/* Returns the slot, that holds name, or the unused slot, where it would go.
+ * The table must have at least one unused slot. */
+static size_t find_slot(const struct namequeue *queue, const char *name)
+{
+	size_t mask = queue->size - 1;
+	size_t i = hashset_hash(name) & mask;
+
+	while(slot_used(queue, i) && strcmp(namequeue_get(queue, queue->slots[i].index), name) != 0)
+		i = (i + 1) & mask;
+	return i;
+}
+
+static bool resize_slots(struct namequeue *queue, size_t size)
+{
+	struct namequeue_slot *slots = malloc(size * sizeof(slots[0]));
+	if(slots == NULL)
+		return false;
+	memset(slots, 0, size * sizeof(slots[0]));
+
+	free(queue->slots);
+	queue->slots = slots;
+	queue->size = size;
+	queue->generation = 1;
+	for(size_t i = 0; i < queue->length; i++) {
+		size_t slot = find_slot(queue, namequeue_get(queue, i));
+		queue->slots[slot].index = i;
+		queue->slots[slot].generation = queue->generation;
+	}
+	return true;
+}
+
+/* Returns buffer grown to hold at least needed items, or NULL, leaving buffer
+ * as it is. */
+static void *reserve(void *buffer, size_t *size, size_t needed, size_t itemsize, size_t minimum)
+{
+	if(needed <= *size)
+		return buffer;
+
+	size_t newsize = *size > 0 ? *size : minimum;
+	while(newsize < needed)
+		newsize *= 2;
+
+	buffer = realloc(buffer, newsize * itemsize);
+	if(buffer != NULL)
+		*size = newsize;
+	return buffer;
+}
+
+/* Adds a copy of name with tag or, if it is queued already, replaces its
+ * tag. */
+bool namequeue_add(struct namequeue *queue, const char *name, int tag)
+{
+	size_t length = strlen(name) + 1;
+
+	if(queue->size > 0) {
+		size_t slot = find_slot(queue, name);
+		if(slot_used(queue, slot)) {
+			queue->order[queue->slots[slot].index].tag = tag;
+			return true;
+		}
+	}
+
+	/* keep a quarter of the slots unused, so that probing stays short */
+	if((queue->length + 1) * 4 > queue->size * 3)
+		if(!resize_slots(queue, queue->size ? queue->size * 2 : NAMEQUEUE_MIN_SIZE))
+			return false;
+
+	struct namequeue_entry *order = reserve(queue->order, &queue->order_size, queue->length + 1, sizeof(order[0]), NAMEQUEUE_MIN_SIZE);
+	if(order == NULL)
+		return false;
+	queue->order = order;
+
+	char *pool = reserve(queue->pool, &queue->pool_size, queue->pool_used + length, 1, NAMEQUEUE_MIN_POOL_SIZE);
+	if(pool == NULL)
+		return false;
+	queue->pool = pool;
+
+	size_t slot = find_slot(queue, name);
+	memcpy(queue->pool + queue->pool_used, name, length);
+	queue->slots[slot].index = queue->length;
+	queue->slots[slot].generation = queue->generation;
+	queue->order[queue->length].name = queue->pool_used;
+	queue->order[queue->length].tag = tag;
+	queue->length++;
+	queue->pool_used += length;
+	return true;
+}
+
+size_t namequeue_length(const struct namequeue *queue)
+{
+	return queue->length;
+}
+
+/* Names are returned in the order they were added first. They stay valid
+ * until the next change of the queue. */
+const char *namequeue_get(const struct namequeue *queue, size_t index)
+{
+	return queue->pool + queue->order[index].name;
+}
+
+int namequeue_gettag(const struct namequeue *queue, size_t index)
+{
+	return queue->order[index].tag;
+}
+
+bool namequeue_contains(const struct namequeue *queue, const char *name)
+{
+	return queue->size > 0 && slot_used(queue, find_slot(queue, name));
+}
+
+/* Empties the queue without touching the slots, only after a burst of names
+ * is followed by a quiet round, the memory is freed. */
+void namequeue_clear(struct namequeue *queue)
+{
+	if(queue->size >= NAMEQUEUE_SHRINK_MIN_SIZE && queue->length * NAMEQUEUE_SHRINK_FACTOR < queue->size) {
+		namequeue_destroy(queue);
+		return;
+	}
+
+	queue->length = 0;
+	queue->pool_used = 0;
+	if(++queue->generation == 0) {
+		memset(queue->slots, 0, queue->size * sizeof(queue->slots[0]));
+		queue->generation = 1;
+	}
+}
+
+void namequeue_init(struct namequeue *queue)
+{
+	queue->slots = NULL;
+	queue->size = 0;
+	queue->generation = 1;
+	queue->order = NULL;
+	queue->length = 0;
+	queue->order_size = 0;
+	queue->pool = NULL;
+	queue->pool_used = 0;
+	queue->pool_size = 0;
+}
+
+void namequeue_destroy(struct namequeue *queue)
+{
+	free(queue->slots);
+	free(queue->order);
+	free(queue->pool);
+	namequeue_init(queue);
+}
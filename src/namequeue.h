@@ -0,0 +1,48 @@
+/* See LICENSE file for copyright and license details. */
+#ifndef NAMEQUEUE_H
+#define NAMEQUEUE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct namequeue_slot {
+	/* position of the name in the queue */
+	size_t index;
+	/* the slot is only used, if this is the generation of the queue */
+	unsigned int generation;
+};
+
+struct namequeue_entry {
+	/* offset of the name in the pool */
+	size_t name;
+	int tag;
+};
+
+/* Collects distinct file names in the order they were added first, each
+ * with the tag it was added with last, until they are taken all at once. The
+ * names are copied into a single pool and found through a hash table, whose
+ * slots are marked with the generation, that used them, so that the queue is
+ * emptied by starting a new one. */
+struct namequeue {
+	struct namequeue_slot *slots;
+	size_t size;
+	unsigned int generation;
+	/* the names in the order they were added */
+	struct namequeue_entry *order;
+	size_t length;
+	size_t order_size;
+	char *pool;
+	size_t pool_used;
+	size_t pool_size;
+};
+
+bool namequeue_add(struct namequeue *queue, const char *name, int tag) __attribute__((warn_unused_result));
+size_t namequeue_length(const struct namequeue *queue);
+const char *namequeue_get(const struct namequeue *queue, size_t index);
+int namequeue_gettag(const struct namequeue *queue, size_t index);
+bool namequeue_contains(const struct namequeue *queue, const char *name);
+void namequeue_clear(struct namequeue *queue);
+void namequeue_init(struct namequeue *queue);
+void namequeue_destroy(struct namequeue *queue);
+
+#endif
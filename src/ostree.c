@@ -0,0 +1,473 @@
+/* See LICENSE file for copyright and license details. */
+#include "ostree.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* A B+-tree, that is ordered by position instead of by key. Every inner node
+ * knows the number of items below each of its children, so that an item can
+ * be found by its index and inserted or removed in O(log n), without moving
+ * all items behind it. */
+
+#define OSTREE_ORDER 64
+#define OSTREE_MIN (OSTREE_ORDER / 2)
+/* more than enough for any number of items, that fits into memory */
+#define OSTREE_MAX_DEPTH 16
+
+struct ostree_node {
+	unsigned int length;
+	bool leaf;
+};
+
+struct ostree_leaf {
+	struct ostree_node node;
+	struct ostree_leaf *next;
+	void *items[OSTREE_ORDER];
+};
+
+struct ostree_inner {
+	struct ostree_node node;
+	size_t counts[OSTREE_ORDER];
+	struct ostree_node *children[OSTREE_ORDER];
+};
+
+struct ostree {
+	struct ostree_node *root;
+	unsigned int depth;
+	size_t length;
+};
+
+struct ostree_path {
+	struct ostree_inner *nodes[OSTREE_MAX_DEPTH];
+	unsigned int slots[OSTREE_MAX_DEPTH];
+};
+
+static struct ostree_leaf *leaf_new(void)
+{
+	struct ostree_leaf *leaf = malloc(sizeof(*leaf));
+	if(leaf == NULL)
+		return NULL;
+
+	leaf->node.length = 0;
+	leaf->node.leaf = true;
+	leaf->next = NULL;
+	return leaf;
+}
+
+static struct ostree_inner *inner_new(void)
+{
+	struct ostree_inner *inner = malloc(sizeof(*inner));
+	if(inner == NULL)
+		return NULL;
+
+	inner->node.length = 0;
+	inner->node.leaf = false;
+	return inner;
+}
+
+static size_t node_count(const struct ostree_node *node)
+{
+	if(node->leaf)
+		return node->length;
+
+	const struct ostree_inner *inner = (const struct ostree_inner *)node;
+	size_t count = 0;
+	for(unsigned int i = 0; i < node->length; i++)
+		count += inner->counts[i];
+	return count;
+}
+
+/* Descends to the leaf, that holds index. With append set, an index equal to
+ * the item count of a child stays in that child, so that items can be
+ * inserted at the end. */
+static struct ostree_leaf *descend(const struct ostree *tree, size_t index, bool append, struct ostree_path *path, unsigned int *position)
+{
+	struct ostree_node *node = tree->root;
+
+	for(unsigned int depth = 0; depth < tree->depth; depth++) {
+		struct ostree_inner *inner = (struct ostree_inner *)node;
+		unsigned int slot = 0;
+
+		while(slot < node->length - 1 && (index > inner->counts[slot] || (!append && index == inner->counts[slot]))) {
+			index -= inner->counts[slot];
+			slot++;
+		}
+		if(path) {
+			path->nodes[depth] = inner;
+			path->slots[depth] = slot;
+		}
+		node = inner->children[slot];
+	}
+	*position = index;
+	return (struct ostree_leaf *)node;
+}
+
+struct ostree *ostree_new(void)
+{
+	struct ostree *tree = malloc(sizeof(*tree));
+	if(tree == NULL)
+		return NULL;
+
+	struct ostree_leaf *leaf = leaf_new();
+	if(leaf == NULL) {
+		free(tree);
+		return NULL;
+	}
+
+	tree->root = &leaf->node;
+	tree->depth = 0;
+	tree->length = 0;
+	return tree;
+}
+
+static void node_delete(struct ostree_node *node, list_item_deallocator deallocator)
+{
+	if(node->leaf) {
+		struct ostree_leaf *leaf = (struct ostree_leaf *)node;
+		if(deallocator)
+			for(unsigned int i = 0; i < node->length; i++)
+				deallocator(leaf->items[i]);
+	} else {
+		struct ostree_inner *inner = (struct ostree_inner *)node;
+		for(unsigned int i = 0; i < node->length; i++)
+			node_delete(inner->children[i], deallocator);
+	}
+	free(node);
+}
+
+void ostree_delete(struct ostree *tree, list_item_deallocator deallocator)
+{
+	if(tree == NULL)
+		return;
+	node_delete(tree->root, deallocator);
+	free(tree);
+}
+
+size_t ostree_length(const struct ostree *tree)
+{
+	return tree->length;
+}
+
+bool ostree_append(struct ostree *tree, void *item)
+{
+	return ostree_insert(tree, tree->length, item);
+}
+
+/* inserts child with count items at slot into a node, that has room for it */
+static void inner_insert(struct ostree_inner *inner, unsigned int slot, struct ostree_node *child, size_t count)
+{
+	unsigned int move = inner->node.length - slot;
+
+	memmove(&inner->children[slot + 1], &inner->children[slot], move * sizeof(inner->children[0]));
+	memmove(&inner->counts[slot + 1], &inner->counts[slot], move * sizeof(inner->counts[0]));
+	inner->children[slot] = child;
+	inner->counts[slot] = count;
+	inner->node.length++;
+}
+
+bool ostree_insert(struct ostree *tree, size_t index, void *item)
+{
+	struct ostree_path path;
+	unsigned int position;
+
+	assert(index <= tree->length);
+
+	struct ostree_leaf *leaf = descend(tree, index, true, &path, &position);
+
+	/* allocate everything, that the splits need, beforehand, so that
+	 * a failure leaves the tree untouched */
+	struct ostree_leaf *newleaf = NULL;
+	struct ostree_inner *newinners[OSTREE_MAX_DEPTH + 1];
+	unsigned int splits = 0;
+
+	if(leaf->node.length == OSTREE_ORDER) {
+		newleaf = leaf_new();
+		if(newleaf == NULL)
+			return false;
+
+		unsigned int depth = tree->depth;
+		while(depth > 0 && path.nodes[depth - 1]->node.length == OSTREE_ORDER)
+			depth--;
+		/* one more for a new root */
+		unsigned int needed = tree->depth - depth + (depth == 0 ? 1 : 0);
+		for(; splits < needed; splits++) {
+			newinners[splits] = inner_new();
+			if(newinners[splits] == NULL)
+				goto err_alloc;
+		}
+	}
+
+	struct ostree_node *newnode = NULL;
+	if(newleaf) {
+		/* move the upper half into the new leaf, then insert */
+		memcpy(newleaf->items, &leaf->items[OSTREE_MIN], (OSTREE_ORDER - OSTREE_MIN) * sizeof(leaf->items[0]));
+		newleaf->node.length = OSTREE_ORDER - OSTREE_MIN;
+		leaf->node.length = OSTREE_MIN;
+		newleaf->next = leaf->next;
+		leaf->next = newleaf;
+		if(position > OSTREE_MIN) {
+			leaf = newleaf;
+			position -= OSTREE_MIN;
+		}
+		newnode = &newleaf->node;
+	}
+	memmove(&leaf->items[position + 1], &leaf->items[position], (leaf->node.length - position) * sizeof(leaf->items[0]));
+	leaf->items[position] = item;
+	leaf->node.length++;
+
+	unsigned int used = 0;
+	for(unsigned int depth = tree->depth; depth > 0; depth--) {
+		struct ostree_inner *inner = path.nodes[depth - 1];
+		unsigned int slot = path.slots[depth - 1];
+
+		if(newnode == NULL) {
+			inner->counts[slot]++;
+			continue;
+		}
+
+		inner->counts[slot] = node_count(inner->children[slot]);
+		size_t newcount = node_count(newnode);
+		if(inner->node.length < OSTREE_ORDER) {
+			inner_insert(inner, slot + 1, newnode, newcount);
+			newnode = NULL;
+			continue;
+		}
+
+		struct ostree_inner *newinner = newinners[used++];
+		memcpy(newinner->children, &inner->children[OSTREE_MIN], (OSTREE_ORDER - OSTREE_MIN) * sizeof(inner->children[0]));
+		memcpy(newinner->counts, &inner->counts[OSTREE_MIN], (OSTREE_ORDER - OSTREE_MIN) * sizeof(inner->counts[0]));
+		newinner->node.length = OSTREE_ORDER - OSTREE_MIN;
+		inner->node.length = OSTREE_MIN;
+		if(slot + 1 > OSTREE_MIN)
+			inner_insert(newinner, slot + 1 - OSTREE_MIN, newnode, newcount);
+		else
+			inner_insert(inner, slot + 1, newnode, newcount);
+		newnode = &newinner->node;
+	}
+
+	if(newnode) {
+		struct ostree_inner *root = newinners[used++];
+		root->children[0] = tree->root;
+		root->counts[0] = node_count(tree->root);
+		root->children[1] = newnode;
+		root->counts[1] = node_count(newnode);
+		root->node.length = 2;
+		tree->root = &root->node;
+		tree->depth++;
+	}
+	assert(used == splits);
+
+	tree->length++;
+	return true;
+
+err_alloc:
+	while(splits > 0)
+		free(newinners[--splits]);
+	free(newleaf);
+	return false;
+}
+
+/* Fixes the underflow of the child at slot by taking an item from or merging
+ * it with a neighbour. */
+static void rebalance(struct ostree_inner *parent, unsigned int slot)
+{
+	unsigned int left = slot > 0 ? slot - 1 : slot;
+	unsigned int right = left + 1;
+	struct ostree_node *l = parent->children[left];
+	struct ostree_node *r = parent->children[right];
+
+	if(l->length + r->length <= OSTREE_ORDER) {
+		if(l->leaf) {
+			struct ostree_leaf *ll = (struct ostree_leaf *)l, *rl = (struct ostree_leaf *)r;
+			memcpy(&ll->items[l->length], rl->items, r->length * sizeof(ll->items[0]));
+			ll->next = rl->next;
+		} else {
+			struct ostree_inner *li = (struct ostree_inner *)l, *ri = (struct ostree_inner *)r;
+			memcpy(&li->children[l->length], ri->children, r->length * sizeof(li->children[0]));
+			memcpy(&li->counts[l->length], ri->counts, r->length * sizeof(li->counts[0]));
+		}
+		l->length += r->length;
+		parent->counts[left] += parent->counts[right];
+		free(r);
+
+		unsigned int move = parent->node.length - right - 1;
+		memmove(&parent->children[right], &parent->children[right + 1], move * sizeof(parent->children[0]));
+		memmove(&parent->counts[right], &parent->counts[right + 1], move * sizeof(parent->counts[0]));
+		parent->node.length--;
+		return;
+	}
+
+	/* the neighbour has enough, move one over */
+	size_t count;
+	if(l->length < r->length) {
+		if(l->leaf) {
+			struct ostree_leaf *ll = (struct ostree_leaf *)l, *rl = (struct ostree_leaf *)r;
+			ll->items[l->length] = rl->items[0];
+			memmove(&rl->items[0], &rl->items[1], (r->length - 1) * sizeof(rl->items[0]));
+			count = 1;
+		} else {
+			struct ostree_inner *li = (struct ostree_inner *)l, *ri = (struct ostree_inner *)r;
+			li->children[l->length] = ri->children[0];
+			li->counts[l->length] = count = ri->counts[0];
+			memmove(&ri->children[0], &ri->children[1], (r->length - 1) * sizeof(ri->children[0]));
+			memmove(&ri->counts[0], &ri->counts[1], (r->length - 1) * sizeof(ri->counts[0]));
+		}
+		l->length++;
+		r->length--;
+		parent->counts[left] += count;
+		parent->counts[right] -= count;
+	} else {
+		if(l->leaf) {
+			struct ostree_leaf *ll = (struct ostree_leaf *)l, *rl = (struct ostree_leaf *)r;
+			memmove(&rl->items[1], &rl->items[0], r->length * sizeof(rl->items[0]));
+			rl->items[0] = ll->items[l->length - 1];
+			count = 1;
+		} else {
+			struct ostree_inner *li = (struct ostree_inner *)l, *ri = (struct ostree_inner *)r;
+			memmove(&ri->children[1], &ri->children[0], r->length * sizeof(ri->children[0]));
+			memmove(&ri->counts[1], &ri->counts[0], r->length * sizeof(ri->counts[0]));
+			ri->children[0] = li->children[l->length - 1];
+			ri->counts[0] = count = li->counts[l->length - 1];
+		}
+		l->length--;
+		r->length++;
+		parent->counts[left] -= count;
+		parent->counts[right] += count;
+	}
+}
+
+void ostree_remove(struct ostree *tree, size_t index)
+{
+	struct ostree_path path;
+	unsigned int position;
+
+	assert(index < tree->length);
+
+	struct ostree_leaf *leaf = descend(tree, index, false, &path, &position);
+	memmove(&leaf->items[position], &leaf->items[position + 1], (leaf->node.length - position - 1) * sizeof(leaf->items[0]));
+	leaf->node.length--;
+
+	for(unsigned int depth = tree->depth; depth > 0; depth--) {
+		struct ostree_inner *inner = path.nodes[depth - 1];
+		unsigned int slot = path.slots[depth - 1];
+
+		inner->counts[slot]--;
+		if(inner->children[slot]->length < OSTREE_MIN)
+			rebalance(inner, slot);
+	}
+
+	while(tree->depth > 0 && tree->root->length == 1) {
+		struct ostree_inner *root = (struct ostree_inner *)tree->root;
+		tree->root = root->children[0];
+		tree->depth--;
+		free(root);
+	}
+	tree->length--;
+}
+
+/* Moves the item without ever going through a state, where it is missing, so
+ * that a failed allocation leaves the tree as it was. */
+bool ostree_move_item(struct ostree *tree, size_t oldindex, size_t newindex)
+{
+	assert(oldindex < tree->length);
+	assert(newindex < tree->length);
+
+	if(oldindex == newindex)
+		return true;
+
+	void *item = ostree_get_item(tree, oldindex);
+	if(oldindex < newindex) {
+		if(!ostree_insert(tree, newindex + 1, item))
+			return false;
+		ostree_remove(tree, oldindex);
+	} else {
+		if(!ostree_insert(tree, newindex, item))
+			return false;
+		ostree_remove(tree, oldindex + 1);
+	}
+	return true;
+}
+
+void *ostree_get_item(const struct ostree *tree, size_t index)
+{
+	unsigned int position;
+
+	assert(index < tree->length);
+
+	struct ostree_leaf *leaf = descend(tree, index, false, NULL, &position);
+	return leaf->items[position];
+}
+
+void ostree_set_item(struct ostree *tree, size_t index, void *item)
+{
+	unsigned int position;
+
+	assert(index < tree->length);
+
+	struct ostree_leaf *leaf = descend(tree, index, false, NULL, &position);
+	leaf->items[position] = item;
+}
+
+/* Same as list_find_item_or_insertpoint, it needs O(log n) comparisons. */
+bool ostree_find_item_or_insertpoint(const struct ostree *tree, int (*compare)(const void *, const void *), const void *item, size_t *index)
+{
+	void *currentitem;
+	size_t min, middle, max;
+	int ret;
+
+	if(tree->length == 0) {
+		*index = 0;
+		return false;
+	}
+
+	min = 0;
+	max = tree->length - 1;
+
+	while(min < max) {
+		middle = (min + max) / 2;
+		currentitem = ostree_get_item(tree, middle);
+		ret = compare(&item, &currentitem);
+		if(ret <= 0)
+			max = middle;
+		else
+			min = middle + 1;
+	}
+
+	*index = min;
+	currentitem = ostree_get_item(tree, *index);
+	ret = compare(&item, &currentitem);
+
+	if(ret > 0 && *index == tree->length - 1)
+		*index = tree->length;
+	return ret == 0;
+}
+
+/* Returns the item at index and points the cursor to it, or NULL, if index
+ * is out of range. */
+void *ostree_seek(const struct ostree *tree, size_t index, struct ostree_cursor *cursor)
+{
+	if(index >= tree->length) {
+		cursor->leaf = NULL;
+		return NULL;
+	}
+
+	cursor->leaf = descend(tree, index, false, NULL, &cursor->position);
+	return cursor->leaf->items[cursor->position];
+}
+
+/* Returns the item after the one, the cursor points to, or NULL at the end. */
+void *ostree_next(struct ostree_cursor *cursor)
+{
+	if(cursor->leaf == NULL)
+		return NULL;
+
+	cursor->position++;
+	while(cursor->position >= cursor->leaf->node.length) {
+		cursor->leaf = cursor->leaf->next;
+		cursor->position = 0;
+		if(cursor->leaf == NULL)
+			return NULL;
+	}
+	return cursor->leaf->items[cursor->position];
+}
@@ -0,0 +1,35 @@
+/* See LICENSE file for copyright and license details. */
+#ifndef OSTREE_H
+#define OSTREE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "list.h"
+
+struct ostree;
+struct ostree_leaf;
+
+/* Walks the items in order without looking each one up. A cursor becomes
+ * invalid, when the tree is modified. */
+struct ostree_cursor {
+	struct ostree_leaf *leaf;
+	unsigned int position;
+};
+
+struct ostree *ostree_new(void) __attribute__((warn_unused_result));
+void ostree_delete(struct ostree *tree, list_item_deallocator deallocator);
+
+size_t ostree_length(const struct ostree *tree);
+bool ostree_append(struct ostree *tree, void *item) __attribute__((warn_unused_result));
+bool ostree_insert(struct ostree *tree, size_t index, void *item) __attribute__((warn_unused_result));
+bool ostree_move_item(struct ostree *tree, size_t oldindex, size_t newindex) __attribute__((warn_unused_result));
+void ostree_remove(struct ostree *tree, size_t index);
+void *ostree_get_item(const struct ostree *tree, size_t index);
+void ostree_set_item(struct ostree *tree, size_t index, void *item);
+bool ostree_find_item_or_insertpoint(const struct ostree *tree, int (*compare)(const void *, const void *), const void *item, size_t *index);
+
+void *ostree_seek(const struct ostree *tree, size_t index, struct ostree_cursor *cursor);
+void *ostree_next(struct ostree_cursor *cursor);
+
+#endif
@@ -0,0 +1,60 @@
+/* See LICENSE file for copyright and license details. */
+#include "radixsort.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RADIX_BITS    8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_MASK    (RADIX_BUCKETS - 1)
+#define RADIX_DIGITS  (64 / RADIX_BITS)
+
+/* Sorts the items by key with a least significant digit first radix sort.
+ * The sort is stable, so items with equal keys keep their order. */
+int radixsort(struct radixsort_item *items, size_t count)
+{
+	size_t histogram[RADIX_DIGITS][RADIX_BUCKETS];
+
+	if(count < 2)
+		return 0;
+
+	struct radixsort_item *buffer = malloc(count * sizeof(*buffer));
+	if(buffer == NULL)
+		return ENOMEM;
+
+	/* count all digits in a single pass over the keys */
+	memset(histogram, 0, sizeof(histogram));
+	for(size_t i = 0; i < count; i++)
+		for(size_t digit = 0; digit < RADIX_DIGITS; digit++)
+			histogram[digit][(items[i].key >> (digit * RADIX_BITS)) & RADIX_MASK]++;
+
+	struct radixsort_item *from = items, *to = buffer;
+	for(size_t digit = 0; digit < RADIX_DIGITS; digit++) {
+		size_t *offsets = histogram[digit];
+		unsigned int shift = digit * RADIX_BITS;
+
+		/* sizes and times mostly share their upper digits, skip the passes,
+		 * that would not move anything */
+		if(offsets[(from[0].key >> shift) & RADIX_MASK] == count)
+			continue;
+
+		size_t offset = 0;
+		for(size_t bucket = 0; bucket < RADIX_BUCKETS; bucket++) {
+			size_t bucketsize = offsets[bucket];
+			offsets[bucket] = offset;
+			offset += bucketsize;
+		}
+		for(size_t i = 0; i < count; i++)
+			to[offsets[(from[i].key >> shift) & RADIX_MASK]++] = from[i];
+
+		struct radixsort_item *swap = from;
+		from = to;
+		to = swap;
+	}
+
+	if(from != items)
+		memcpy(items, from, count * sizeof(*items));
+	free(buffer);
+	return 0;
+}
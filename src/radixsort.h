@@ -0,0 +1,15 @@
+/* See LICENSE file for copyright and license details. */
+#ifndef RADIXSORT_H
+#define RADIXSORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct radixsort_item {
+	uint64_t key;
+	void *item;
+};
+
+int radixsort(struct radixsort_item *items, size_t count) __attribute__((warn_unused_result));
+
+#endif
@@ -0,0 +1,68 @@
+/* See LICENSE file for copyright and license details. */
+#include "refreshscheduler.h"
+
+/* the window is doubled with each flush, that had events and followed the
+ * one before within twice the window, up to the maximum, and starts over at
+ * the minimum after a longer quiet time */
+#define REFRESH_MIN_WINDOW 50
+#define REFRESH_MAX_WINDOW 800
+
+/* Records count new events. Returns true, if this scheduled a flush, so that
+ * a timer has to be set to the due time. */
+bool refreshscheduler_add_events(struct refreshscheduler *scheduler, uint64_t now, size_t count)
+{
+	if(count == 0)
+		return false;
+
+	scheduler->events += count;
+	if(scheduler->scheduled)
+		return false;
+
+	scheduler->scheduled = true;
+	if(now - scheduler->last_flush >= scheduler->window)
+		scheduler->due = now;
+	else
+		scheduler->due = scheduler->last_flush + scheduler->window;
+	return true;
+}
+
+/* Adapts the window to how busy the directory is. If more is true, some
+ * changes were left for later, so the next flush is scheduled a window
+ * from now. */
+void refreshscheduler_flushed(struct refreshscheduler *scheduler, uint64_t now, bool more)
+{
+	uint64_t elapsed = now - scheduler->last_flush;
+
+	if(scheduler->events > 0) {
+		if(elapsed < 2 * (uint64_t)scheduler->window) {
+			scheduler->window *= 2;
+			if(scheduler->window > REFRESH_MAX_WINDOW)
+				scheduler->window = REFRESH_MAX_WINDOW;
+		} else {
+			scheduler->window = REFRESH_MIN_WINDOW;
+		}
+	}
+
+	uint64_t rate = scheduler->events * 1000 / (elapsed > 0 ? elapsed : 1);
+	scheduler->rate = (3 * (uint64_t)scheduler->rate + rate) / 4;
+
+	scheduler->events = 0;
+	scheduler->last_flush = now;
+	scheduler->scheduled = more;
+	scheduler->due = now + scheduler->window;
+}
+
+bool refreshscheduler_isdue(const struct refreshscheduler *scheduler, uint64_t now)
+{
+	return scheduler->scheduled && scheduler->due <= now;
+}
+
+void refreshscheduler_init(struct refreshscheduler *scheduler)
+{
+	scheduler->last_flush = 0;
+	scheduler->window = REFRESH_MIN_WINDOW;
+	scheduler->scheduled = false;
+	scheduler->due = 0;
+	scheduler->events = 0;
+	scheduler->rate = 0;
+}
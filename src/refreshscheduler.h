@@ -0,0 +1,29 @@
+/* See LICENSE file for copyright and license details. */
+#ifndef REFRESHSCHEDULER_H
+#define REFRESHSCHEDULER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Decides, when changes in the directory are applied. A change after a quiet
+ * time is applied at once, while changes, that keep coming, are collected for
+ * a window, that grows as long as they go on. All times are in milliseconds
+ * of a monotonic clock. */
+struct refreshscheduler {
+	uint64_t last_flush;
+	unsigned int window;
+	/* a flush is due at this time */
+	bool scheduled;
+	uint64_t due;
+	/* events since the last flush and the smoothed events per second */
+	size_t events;
+	unsigned int rate;
+};
+
+bool refreshscheduler_add_events(struct refreshscheduler *scheduler, uint64_t now, size_t count);
+void refreshscheduler_flushed(struct refreshscheduler *scheduler, uint64_t now, bool more);
+bool refreshscheduler_isdue(const struct refreshscheduler *scheduler, uint64_t now);
+void refreshscheduler_init(struct refreshscheduler *scheduler);
+
+#endif
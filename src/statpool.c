@@ -0,0 +1,150 @@
+/* See LICENSE file for copyright and license details. */
+#include "statpool.h"
+
+#include "filedata.h"
+#include "list.h"
+#include "uringstat.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define STATPOOL_MAX_THREADS 16
+/* below this many entries per thread, the thread startup costs more than the
+ * stat calls it takes over */
+#define STATPOOL_MIN_ITEMS_PER_THREAD 256
+#define STATPOOL_CHUNK_SIZE 64
+/* setting up an io_uring does not pay off for a handful of entries */
+#define STATPOOL_MIN_ITEMS_IO_URING 64
+
+struct statpool_job {
+	int dirfd;
+	struct list *list;
+	size_t length;
+	bool *vanished;
+	atomic_size_t next;
+};
+
+static void *statpool_worker(void *data)
+{
+	struct statpool_job *job = data;
+
+	while(1) {
+		size_t start = atomic_fetch_add(&job->next, STATPOOL_CHUNK_SIZE);
+		if(start >= job->length)
+			break;
+
+		size_t end = start + STATPOOL_CHUNK_SIZE;
+		if(end > job->length)
+			end = job->length;
+
+		for(size_t i = start; i < end; i++) {
+			struct filedata *filedata = list_get_item(job->list, i);
+			job->vanished[i] = (filedata_stat(filedata, job->dirfd) == ENOENT);
+		}
+	}
+	return NULL;
+}
+
+static void stat_with_threads(struct statpool_job *job, unsigned int threads)
+{
+	if(threads > STATPOOL_MAX_THREADS)
+		threads = STATPOOL_MAX_THREADS;
+	if(threads > job->length / STATPOOL_MIN_ITEMS_PER_THREAD)
+		threads = job->length / STATPOOL_MIN_ITEMS_PER_THREAD;
+
+	/* the calling thread is worker number one, if any thread fails to
+	 * start, the remaining ones just get more work */
+	pthread_t workers[STATPOOL_MAX_THREADS];
+	unsigned int started = 0;
+	for(unsigned int i = 1; i < threads; i++) {
+		if(pthread_create(&workers[started], NULL, statpool_worker, job) != 0)
+			break;
+		started++;
+	}
+	statpool_worker(job);
+	for(unsigned int i = 0; i < started; i++)
+		pthread_join(workers[i], NULL);
+}
+
+/* Errors, that mean, that io_uring or its statx cannot be used here at all,
+ * unlike a temporary shortage of memory or other resources. */
+static bool io_uring_unsupported(int error)
+{
+	return error == ENOSYS || error == EINVAL || error == EPERM || error == EOPNOTSUPP;
+}
+
+/* Stats every filedata in list, either with batched statx requests on an
+ * io_uring or by fanning the work out over up to pool->threads threads.
+ * vanished must have room for one flag per entry and tells afterwards, which
+ * entries vanished in the meantime. */
+void statpool_stat_entries(struct statpool *pool, int dirfd, struct list *list, bool *vanished)
+{
+	size_t length = list_length(list);
+	if(length == 0)
+		return;
+
+	if(pool->use_io_uring && length >= STATPOOL_MIN_ITEMS_IO_URING) {
+		int ret = uringstat_stat_list(dirfd, list, vanished);
+		if(ret == 0)
+			return;
+		if(io_uring_unsupported(ret))
+			pool->use_io_uring = false;
+	}
+
+	struct statpool_job job = {
+		.dirfd = dirfd,
+		.list = list,
+		.length = length,
+		.vanished = vanished,
+	};
+	atomic_init(&job.next, 0);
+
+	stat_with_threads(&job, pool->threads);
+}
+
+/* Like statpool_stat_entries, but entries, that vanished in the meantime,
+ * are deleted from arena and removed from the list, the order of the
+ * remaining entries is kept. */
+int statpool_stat_list(struct statpool *pool, int dirfd, struct list *list, struct arena *arena)
+{
+	size_t length = list_length(list);
+	if(length == 0)
+		return 0;
+
+	bool *vanished = malloc(length * sizeof(vanished[0]));
+	if(vanished == NULL)
+		return ENOMEM;
+
+	statpool_stat_entries(pool, dirfd, list, vanished);
+
+	size_t kept = 0;
+	for(size_t i = 0; i < length; i++) {
+		struct filedata *filedata = list_get_item(list, i);
+		if(vanished[i])
+			filedata_arena_delete(arena, filedata);
+		else
+			list_set_item(list, kept++, filedata);
+	}
+	for(size_t i = length; i > kept; i--)
+		list_remove(list, i - 1);
+
+	free(vanished);
+	return 0;
+}
+
+void statpool_init(struct statpool *pool)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if(cpus < 1)
+		pool->threads = 1;
+	else if(cpus > STATPOOL_MAX_THREADS)
+		pool->threads = STATPOOL_MAX_THREADS;
+	else
+		pool->threads = cpus;
+	pool->use_io_uring = true;
+}
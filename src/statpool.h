@@ -0,0 +1,19 @@
+/* See LICENSE file for copyright and license details. */
+#ifndef STATPOOL_H
+#define STATPOOL_H
+
+#include <stdbool.h>
+
+struct arena;
+struct list;
+
+struct statpool {
+	unsigned int threads;
+	bool use_io_uring;
+};
+
+void statpool_stat_entries(struct statpool *pool, int dirfd, struct list *list, bool *vanished);
+int statpool_stat_list(struct statpool *pool, int dirfd, struct list *list, struct arena *arena) __attribute__((warn_unused_result));
+void statpool_init(struct statpool *pool);
+
+#endif
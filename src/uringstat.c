@@ -0,0 +1,304 @@
+/* See LICENSE file for copyright and license details. */
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+#include "uringstat.h"
+
+#include "filedata.h"
+#include "list.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <linux/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+#define URINGSTAT_QUEUE_DEPTH 256
+
+struct uring {
+	int fd;
+	void *sq_ptr;
+	size_t sq_size;
+	void *cq_ptr;
+	size_t cq_size;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+	unsigned to_submit;
+};
+
+/* one in-flight request, for symlinks the slot is reused for the second
+ * statx on the link target */
+struct slot {
+	struct statx statx;
+	struct stat lstat;
+	size_t index;
+	bool valid;
+	bool follow;
+};
+
+static int uring_init(struct uring *ring, unsigned entries)
+{
+	struct io_uring_params params;
+
+	memset(&params, 0, sizeof(params));
+	ring->fd = syscall(__NR_io_uring_setup, entries, &params);
+	if(ring->fd < 0)
+		return errno;
+
+	ring->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if(params.features & IORING_FEAT_SINGLE_MMAP) {
+		if(ring->cq_size > ring->sq_size)
+			ring->sq_size = ring->cq_size;
+		ring->cq_size = ring->sq_size;
+	}
+
+	ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	if(ring->sq_ptr == MAP_FAILED)
+		goto err_sq;
+
+	if(params.features & IORING_FEAT_SINGLE_MMAP) {
+		ring->cq_ptr = ring->sq_ptr;
+	} else {
+		ring->cq_ptr = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+		if(ring->cq_ptr == MAP_FAILED)
+			goto err_cq;
+	}
+
+	ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+	if(ring->sqes == MAP_FAILED)
+		goto err_sqes;
+
+	ring->sq_head = (unsigned *)((char *)ring->sq_ptr + params.sq_off.head);
+	ring->sq_tail = (unsigned *)((char *)ring->sq_ptr + params.sq_off.tail);
+	ring->sq_mask = (unsigned *)((char *)ring->sq_ptr + params.sq_off.ring_mask);
+	ring->sq_array = (unsigned *)((char *)ring->sq_ptr + params.sq_off.array);
+	ring->cq_head = (unsigned *)((char *)ring->cq_ptr + params.cq_off.head);
+	ring->cq_tail = (unsigned *)((char *)ring->cq_ptr + params.cq_off.tail);
+	ring->cq_mask = (unsigned *)((char *)ring->cq_ptr + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *)((char *)ring->cq_ptr + params.cq_off.cqes);
+	ring->to_submit = 0;
+
+	return 0;
+
+err_sqes:
+	if(ring->cq_ptr != ring->sq_ptr)
+		munmap(ring->cq_ptr, ring->cq_size);
+err_cq:
+	munmap(ring->sq_ptr, ring->sq_size);
+err_sq:
+	close(ring->fd);
+	return ENOMEM;
+}
+
+static void uring_destroy(struct uring *ring)
+{
+	munmap(ring->sqes, ring->sqes_size);
+	if(ring->cq_ptr != ring->sq_ptr)
+		munmap(ring->cq_ptr, ring->cq_size);
+	munmap(ring->sq_ptr, ring->sq_size);
+	close(ring->fd);
+}
+
+static void uring_queue_statx(struct uring *ring, int dirfd, const char *filename, int flags, struct statx *statx, unsigned slot)
+{
+	unsigned tail = *ring->sq_tail;
+	unsigned index = tail & *ring->sq_mask;
+	struct io_uring_sqe *sqe = &ring->sqes[index];
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_STATX;
+	sqe->fd = dirfd;
+	sqe->addr = (unsigned long)filename;
+	sqe->len = STATX_BASIC_STATS;
+	sqe->off = (unsigned long)statx;
+	sqe->statx_flags = flags;
+	sqe->user_data = slot;
+
+	ring->sq_array[index] = index;
+	__atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	ring->to_submit++;
+}
+
+static int uring_submit_and_wait(struct uring *ring)
+{
+	int ret;
+
+	do {
+		ret = syscall(__NR_io_uring_enter, ring->fd, ring->to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+	} while(ret < 0 && errno == EINTR);
+
+	if(ret < 0)
+		return errno;
+	ring->to_submit -= ret;
+	return 0;
+}
+
+/* Waits for a completion without submitting anything. */
+static int uring_wait(struct uring *ring)
+{
+	int ret;
+
+	do {
+		ret = syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+	} while(ret < 0 && errno == EINTR);
+
+	return ret < 0 ? errno : 0;
+}
+
+static void statx_to_stat(const struct statx *statx, struct stat *stat)
+{
+	memset(stat, 0, sizeof(*stat));
+	stat->st_dev = makedev(statx->stx_dev_major, statx->stx_dev_minor);
+	stat->st_ino = statx->stx_ino;
+	stat->st_mode = statx->stx_mode;
+	stat->st_nlink = statx->stx_nlink;
+	stat->st_uid = statx->stx_uid;
+	stat->st_gid = statx->stx_gid;
+	stat->st_rdev = makedev(statx->stx_rdev_major, statx->stx_rdev_minor);
+	stat->st_size = statx->stx_size;
+	stat->st_blksize = statx->stx_blksize;
+	stat->st_blocks = statx->stx_blocks;
+	stat->st_atim.tv_sec = statx->stx_atime.tv_sec;
+	stat->st_atim.tv_nsec = statx->stx_atime.tv_nsec;
+	stat->st_mtim.tv_sec = statx->stx_mtime.tv_sec;
+	stat->st_mtim.tv_nsec = statx->stx_mtime.tv_nsec;
+	stat->st_ctim.tv_sec = statx->stx_ctime.tv_sec;
+	stat->st_ctim.tv_nsec = statx->stx_ctime.tv_nsec;
+}
+
+/* Stats every filedata in list with batched statx requests on an io_uring.
+ * Entries, that don't exist anymore, are flagged in vanished. If io_uring
+ * turns out to be unusable, an error is returned and the entries have to be
+ * stat'ed the conventional way. */
+int uringstat_stat_list(int dirfd, const struct list *list, bool *vanished)
+{
+	size_t length = list_length(list);
+	if(length == 0)
+		return 0;
+
+	unsigned depth = URINGSTAT_QUEUE_DEPTH;
+	while(depth / 2 >= length)
+		depth /= 2;
+
+	struct uring ring;
+	int ret = uring_init(&ring, depth);
+	if(ret != 0)
+		return ret;
+
+	struct slot *slots = malloc(depth * sizeof(*slots));
+	unsigned *free_slots = malloc(depth * sizeof(*free_slots));
+	if(slots == NULL || free_slots == NULL) {
+		ret = ENOMEM;
+		goto out;
+	}
+
+	unsigned free_count = depth;
+	for(unsigned i = 0; i < depth; i++)
+		free_slots[i] = i;
+
+	/* set once submitting fails or a request fails in a way, that makes the
+	 * ring unusable */
+	int failed = 0;
+	size_t next = 0;
+	while(failed == 0 ? next < length || free_count < depth : free_count + ring.to_submit < depth) {
+		if(failed == 0) {
+			while(free_count > 0 && next < length) {
+				unsigned s = free_slots[--free_count];
+				struct filedata *filedata = list_get_item(list, next);
+
+				slots[s].index = next++;
+				slots[s].follow = false;
+				uring_queue_statx(&ring, dirfd, filedata->filename, AT_SYMLINK_NOFOLLOW, &slots[s].statx, s);
+			}
+
+			failed = uring_submit_and_wait(&ring);
+		}
+
+		/* after a failure, nothing is queued anymore, but the requests
+		 * already submitted still write into their slots, so they are
+		 * waited for before the slots are freed */
+		if(failed != 0) {
+			if(free_count + ring.to_submit == depth)
+				break;
+			if(uring_wait(&ring) != 0) {
+				/* the kernel may still write into them later */
+				slots = NULL;
+				break;
+			}
+		}
+
+		unsigned head = *ring.cq_head;
+		unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+		for(; head != tail; head++) {
+			struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+			unsigned s = cqe->user_data;
+			struct slot *slot = &slots[s];
+			struct filedata *filedata = list_get_item(list, slot->index);
+
+			/* statx itself never fails with EINVAL for our flags, so the
+			 * kernel does not know IORING_OP_STATX */
+			if(failed == 0 && cqe->res == -EINVAL)
+				failed = EINVAL;
+			if(failed != 0) {
+				free_slots[free_count++] = s;
+				continue;
+			}
+
+			if(slot->follow) {
+				struct stat target;
+				if(cqe->res == 0) {
+					statx_to_stat(&slot->statx, &target);
+					filedata_set_stat(filedata, &slot->lstat, slot->valid, &target);
+				} else {
+					filedata_set_stat(filedata, &slot->lstat, slot->valid, NULL);
+				}
+				free_slots[free_count++] = s;
+				continue;
+			}
+
+			vanished[slot->index] = (cqe->res == -ENOENT);
+			if(vanished[slot->index]) {
+				free_slots[free_count++] = s;
+				continue;
+			}
+
+			slot->valid = (cqe->res == 0);
+			if(slot->valid)
+				statx_to_stat(&slot->statx, &slot->lstat);
+			else
+				memset(&slot->lstat, 0, sizeof(slot->lstat));
+
+			if(S_ISLNK(slot->lstat.st_mode)) {
+				slot->follow = true;
+				uring_queue_statx(&ring, dirfd, filedata->filename, 0, &slot->statx, s);
+			} else {
+				filedata_set_stat(filedata, &slot->lstat, slot->valid, NULL);
+				free_slots[free_count++] = s;
+			}
+		}
+		__atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+	}
+	ret = failed;
+
+out:
+	free(free_slots);
+	free(slots);
+	uring_destroy(&ring);
+	return ret;
+}
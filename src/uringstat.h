@@ -0,0 +1,11 @@
+/* See LICENSE file for copyright and license details. */
+#ifndef URINGSTAT_H
+#define URINGSTAT_H
+
+#include <stdbool.h>
+
+struct list;
+
+int uringstat_stat_list(int dirfd, const struct list *list, bool *vanished) __attribute__((warn_unused_result));
+
+#endif
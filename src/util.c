@@ -12,6 +12,7 @@
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 static int remove_file(const char *path, const struct stat *sbuf, int type, struct FTW *ftwb)
@@ -108,3 +109,12 @@ bool run_in_foreground()
 
 	return false;
 }
+
+/* Milliseconds since some point in the past, for measuring intervals. */
+uint64_t monotonic_ms(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
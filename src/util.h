@@ -3,6 +3,7 @@
 #define UTIL_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 struct list;
 
@@ -14,5 +15,6 @@ struct path *determine_usable_config_file(const char *project, const char *subdi
 bool dump_string_to_file(int dir_fd, const char *filename, const char *value);
 bool dump_filelist_to_file(int dir_fd, const char *filename, const struct list *list);
 bool run_in_foreground();
+uint64_t monotonic_ms(void);
 
 #endif
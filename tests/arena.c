@@ -0,0 +1,110 @@
+/* See LICENSE file for copyright and license details. */
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/arena.h"
+#include "tests.h"
+
+static struct arena arena;
+
+static void setup(void)
+{
+	arena_init(&arena);
+}
+
+static void teardown(void)
+{
+	arena_destroy(&arena);
+}
+
+START_TEST(test_arena_alloc)
+{
+	char *items[1000];
+
+	for(size_t i = 0; i < 1000; i++) {
+		items[i] = arena_alloc(&arena, 100);
+		assert_oom(items[i] != NULL);
+		ck_assert_uint_eq((uintptr_t)items[i] % ARENA_ALIGNMENT, 0);
+		memset(items[i], i & 0xff, 100);
+	}
+	for(size_t i = 0; i < 1000; i++)
+		ck_assert_uint_eq((unsigned char)items[i][99], i & 0xff);
+}
+END_TEST
+
+START_TEST(test_arena_free_reuse)
+{
+	void *a, *b, *c;
+
+	a = arena_alloc(&arena, 40);
+	assert_oom(a != NULL);
+	b = arena_alloc(&arena, 60);
+	assert_oom(b != NULL);
+
+	arena_free(&arena, a, 40);
+	arena_free(&arena, b, 60);
+
+	/* same size class gets the freed memory back */
+	c = arena_alloc(&arena, 37);
+	ck_assert_ptr_eq(c, a);
+	c = arena_alloc(&arena, 58);
+	ck_assert_ptr_eq(c, b);
+}
+END_TEST
+
+START_TEST(test_arena_large)
+{
+	char *large = arena_alloc(&arena, 4 * ARENA_MAX_SIZE);
+	assert_oom(large != NULL);
+	memset(large, 0, 4 * ARENA_MAX_SIZE);
+
+	/* large objects are only released with the arena */
+	arena_free(&arena, large, 4 * ARENA_MAX_SIZE);
+	void *small = arena_alloc(&arena, 16);
+	assert_oom(small != NULL);
+	ck_assert(small != large);
+}
+END_TEST
+
+START_TEST(test_arena_merge)
+{
+	struct arena other;
+	void *a;
+
+	arena_init(&other);
+	a = arena_alloc(&other, 32);
+	assert_oom_cleanup(a != NULL, arena_destroy(&other));
+
+	arena_merge(&arena, &other);
+	ck_assert_ptr_eq(other.chunks, NULL);
+	ck_assert(arena.chunks != NULL);
+	ck_assert_uint_eq(arena.allocated, 32);
+	ck_assert_uint_eq(arena.capacity, ARENA_CHUNK_SIZE);
+
+	/* memory of the other arena can be freed to and reused from this one */
+	arena_free(&arena, a, 32);
+	ck_assert_ptr_eq(arena_alloc(&arena, 32), a);
+
+	arena_destroy(&other);
+}
+END_TEST
+
+Suite *arena_suite(void)
+{
+	Suite *suite;
+	TCase *tcase;
+
+	suite = suite_create("Arena");
+
+	tcase = tcase_create("Core");
+	tcase_add_checked_fixture(tcase, setup, teardown);
+	tcase_add_test(tcase, test_arena_alloc);
+	tcase_add_test(tcase, test_arena_free_reuse);
+	tcase_add_test(tcase, test_arena_large);
+	tcase_add_test(tcase, test_arena_merge);
+	suite_add_tcase(suite, tcase);
+
+	return suite;
+}
@@ -0,0 +1,263 @@
+/* See LICENSE file for copyright and license details. */
+#include <check.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "../src/arena.h"
+#include "../src/dirloader.h"
+#include "../src/filedata.h"
+#include "../src/list.h"
+#include "../src/util.h"
+#include "tests.h"
+
+#define PATH_TEMPLATE "/tmp/dirloader.XXXXXX"
+
+static char path[] = PATH_TEMPLATE;
+static int dir_fd;
+static struct dirloader loader;
+static struct dirloader_options options;
+/* what the loads tell about the stat method */
+static struct statpool statpool;
+static struct list *entries;
+static struct arena arena;
+
+static void create_temp_directory()
+{
+	strcpy(path, PATH_TEMPLATE);
+	ck_assert(mkdtemp(path) != NULL);
+}
+
+static void create_files(size_t count)
+{
+	char filename[16];
+
+	for(size_t i = 0; i < count; i++) {
+		sprintf(filename, "%03zu", i);
+		int fd = openat(dir_fd, filename, O_CREAT|O_WRONLY, 0777);
+		close(fd);
+	}
+}
+
+static void setup(void)
+{
+	create_temp_directory();
+	dir_fd = open(path, O_RDONLY);
+	dirloader_init(&loader);
+	options.defer = false;
+	options.first_batch_size = 0;
+	statpool_init(&options.statpool);
+	options.statpool.use_io_uring = false;
+	statpool_init(&statpool);
+	entries = list_new(0);
+	arena_init(&arena);
+}
+
+static void teardown(void)
+{
+	list_delete(entries, NULL);
+	arena_destroy(&arena);
+	dirloader_destroy(&loader);
+	close(dir_fd);
+	remove_directory_recursively(path);
+}
+
+/* takes all batches into entries, returns the number of batches or -1 on
+ * error */
+static int take_all(int *dirfd)
+{
+	struct pollfd pollfd = { .fd = loader.eventfd, .events = POLLIN };
+	int batches = 0;
+
+	*dirfd = -1;
+	while(1) {
+		struct list *batch;
+		int fd;
+
+		int ret = dirloader_take(&loader, &fd, &batch, &arena, &statpool);
+		if(fd >= 0) {
+			ck_assert_int_eq(*dirfd, -1);
+			*dirfd = fd;
+		}
+		if(ret == EAGAIN) {
+			ck_assert_int_eq(poll(&pollfd, 1, 5000), 1);
+			continue;
+		}
+		if(ret != 0)
+			return -1;
+		if(batch == NULL)
+			return batches;
+
+		ck_assert(*dirfd >= 0);
+		batches++;
+		for(size_t i = 0; i < list_length(batch); i++) {
+			if(!list_append(entries, list_get_item(batch, i))) {
+				list_delete(batch, NULL);
+				return -1;
+			}
+		}
+		list_delete(batch, NULL);
+	}
+}
+
+START_TEST(test_dirloader_load)
+{
+	int dirfd;
+	struct list *list;
+
+	create_files(10);
+	mkdirat(dir_fd, "dir", 0700);
+
+	assert_oom(dirloader_load(path, &options, &dirfd, &list, &arena) == 0);
+	ck_assert_uint_eq(list_length(list), 11);
+	for(size_t i = 0; i < list_length(list); i++) {
+		struct filedata *filedata = list_get_item(list, i);
+		ck_assert(filedata->is_stat_valid);
+		ck_assert(!filedata->is_stat_pending);
+		ck_assert(S_ISDIR(filedata->mode) == (strcmp(filedata->filename, "dir") == 0));
+	}
+	list_delete(list, NULL);
+	close(dirfd);
+}
+END_TEST
+
+START_TEST(test_dirloader_load_deferred)
+{
+	int dirfd;
+	struct list *list;
+
+	create_files(10);
+	options.defer = true;
+
+	assert_oom(dirloader_load(path, &options, &dirfd, &list, &arena) == 0);
+	ck_assert_uint_eq(list_length(list), 10);
+	for(size_t i = 0; i < list_length(list); i++) {
+		struct filedata *filedata = list_get_item(list, i);
+		ck_assert(filedata->is_stat_pending);
+		ck_assert(S_ISREG(filedata->mode));
+	}
+	list_delete(list, NULL);
+	close(dirfd);
+}
+END_TEST
+
+START_TEST(test_dirloader_load_nonexistent)
+{
+	int dirfd;
+	struct list *list;
+
+	ck_assert_int_eq(dirloader_load("/nonexistent", &options, &dirfd, &list, &arena), ENOENT);
+}
+END_TEST
+
+START_TEST(test_dirloader_start)
+{
+	int dirfd;
+
+	create_files(100);
+	options.first_batch_size = 8;
+
+	assert_oom(dirloader_start(&loader, path, &options) == true);
+	ck_assert(dirloader_isrunning(&loader));
+	/* 8 + 16 + 32 + 44 */
+	assert_oom(take_all(&dirfd) == 4);
+	ck_assert(!dirloader_isrunning(&loader));
+	ck_assert_uint_eq(list_length(entries), 100);
+	close(dirfd);
+}
+END_TEST
+
+START_TEST(test_dirloader_start_statpool)
+{
+	int dirfd;
+
+	create_files(10);
+
+	/* the worker only switches its copy, which is handed back at the end */
+	assert_oom(dirloader_start(&loader, path, &options) == true);
+	assert_oom(take_all(&dirfd) == 1);
+	ck_assert(!statpool.use_io_uring);
+	close(dirfd);
+
+	statpool.use_io_uring = true;
+	options.statpool.use_io_uring = true;
+	assert_oom(dirloader_start(&loader, path, &options) == true);
+	assert_oom(take_all(&dirfd) == 1);
+	ck_assert(statpool.use_io_uring);
+	close(dirfd);
+}
+END_TEST
+
+START_TEST(test_dirloader_start_nonexistent)
+{
+	int dirfd;
+
+	assert_oom(dirloader_start(&loader, "/nonexistent", &options) == true);
+	ck_assert_int_eq(take_all(&dirfd), -1);
+	ck_assert_int_eq(dirfd, -1);
+	ck_assert(!dirloader_isrunning(&loader));
+}
+END_TEST
+
+START_TEST(test_dirloader_cancel)
+{
+	int dirfd;
+
+	create_files(100);
+	options.first_batch_size = 8;
+
+	assert_oom(dirloader_start(&loader, path, &options) == true);
+	dirloader_cancel(&loader);
+	ck_assert(!dirloader_isrunning(&loader));
+
+	/* nothing is left to take from a cancelled load */
+	struct list *batch;
+	ck_assert_int_eq(dirloader_take(&loader, &dirfd, &batch, &arena, &statpool), 0);
+	ck_assert_int_eq(dirfd, -1);
+	ck_assert_ptr_eq(batch, NULL);
+	ck_assert_ptr_eq(arena.chunks, NULL);
+
+	assert_oom(dirloader_start(&loader, path, &options) == true);
+	assert_oom(take_all(&dirfd) == 4);
+	ck_assert_uint_eq(list_length(entries), 100);
+	close(dirfd);
+}
+END_TEST
+
+START_TEST(test_dirloader_noeventfd)
+{
+	close(loader.eventfd);
+	loader.eventfd = -1;
+
+	ck_assert(!dirloader_start(&loader, path, &options));
+	ck_assert(!dirloader_isrunning(&loader));
+}
+END_TEST
+
+Suite *dirloader_suite(void)
+{
+	Suite *suite;
+	TCase *tcase;
+
+	suite = suite_create("Dirloader");
+
+	tcase = tcase_create("Core");
+	tcase_add_checked_fixture(tcase, setup, teardown);
+	tcase_add_test(tcase, test_dirloader_load);
+	tcase_add_test(tcase, test_dirloader_load_deferred);
+	tcase_add_test(tcase, test_dirloader_load_nonexistent);
+	tcase_add_test(tcase, test_dirloader_start);
+	tcase_add_test(tcase, test_dirloader_start_statpool);
+	tcase_add_test(tcase, test_dirloader_start_nonexistent);
+	tcase_add_test(tcase, test_dirloader_cancel);
+	tcase_add_test(tcase, test_dirloader_noeventfd);
+	suite_add_tcase(suite, tcase);
+
+	return suite;
+}
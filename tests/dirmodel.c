@@ -4,13 +4,17 @@
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #include "wrapper/fstatat.h"
 #include "../src/dirmodel.h"
+#include "../src/filedata.h"
 #include "../src/list.h"
 #include "../src/util.h"
 #include "tests.h"
@@ -37,6 +41,17 @@ static void create_file(int dir_fd, const char *filename, off_t size)
 	close(fd);
 }
 
+static void create_numbered_files(size_t count)
+{
+	char filename[] = "00";
+
+	for(size_t i = 0; i < count; i++) {
+		filename[0] = '0' + i / 10;
+		filename[1] = '0' + i % 10;
+		create_file(dir_fd, filename, 0);
+	}
+}
+
 static void setup(void)
 {
 	create_temp_directory();
@@ -165,6 +180,39 @@ START_TEST(test_dirmodel_populateddirectory_order)
 }
 END_TEST
 
+START_TEST(test_dirmodel_populateddirectory_parallelstat)
+{
+	char filename[16];
+	off_t dirsize = 0;
+
+	for(size_t i = 0; i < 1024; i++) {
+		sprintf(filename, "%04zu", 1023 - i);
+		if(i % 2) {
+			mkdirat(dir_fd, filename, 0x700);
+		} else {
+			create_file(dir_fd, filename, i);
+			dirsize += i;
+		}
+	}
+
+	model.statpool.threads = 4;
+	model.statpool.use_io_uring = false;
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 1024);
+	ck_assert_uint_eq(dirmodel_getdirsize(&model), dirsize);
+
+	/* directories come first, then files, each group ordered by name */
+	for(size_t i = 0; i < 512; i++) {
+		sprintf(filename, "%04zu", 2 * i);
+		ck_assert_str_eq(dirmodel_getfilename(&model, i), filename);
+		ck_assert(dirmodel_isdir(&model, i));
+		sprintf(filename, "%04zu", 2 * i + 1);
+		ck_assert_str_eq(dirmodel_getfilename(&model, 512 + i), filename);
+		ck_assert(!dirmodel_isdir(&model, 512 + i));
+	}
+}
+END_TEST
+
 static struct {
 	const char *name;
 	const wchar_t *rendered;
@@ -247,6 +295,96 @@ START_TEST(test_dirmodel_addedfileevent)
 }
 END_TEST
 
+static size_t cb_added_before[3];
+static size_t cb_removed_before[3];
+
+static void batch_change_callback(enum model_change change, size_t newindex, size_t oldindex, void *data)
+{
+	const size_t *oldindexes = data;
+
+	change_callback(change, newindex, oldindex, data);
+	if(change == MODEL_ADD_BATCH)
+		for(size_t i = 0; i < 3; i++)
+			cb_added_before[i] = listmodel_added_before(&model.listmodel, oldindexes[i]);
+	if(change == MODEL_REMOVE_BATCH)
+		for(size_t i = 0; i < 3; i++)
+			cb_removed_before[i] = listmodel_removed_before(&model.listmodel, oldindexes[i]);
+}
+
+START_TEST(test_dirmodel_addedfileevent_batch)
+{
+	const size_t oldindexes[] = { 0, 2, 4 };
+	const char *names[] = { "0", "1", "2", "3", "4", "5", "6", "8", "9" };
+
+	cb_count = 0;
+	create_file(dir_fd, "0", 0);
+	create_file(dir_fd, "2", 0);
+	create_file(dir_fd, "4", 0);
+	create_file(dir_fd, "6", 0);
+	create_file(dir_fd, "8", 0);
+	assert_oom(listmodel_register_change_callback(&model.listmodel, batch_change_callback, (void *)oldindexes) == true);
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+
+	create_file(dir_fd, "9", 0);
+	create_file(dir_fd, "5", 0);
+	create_file(dir_fd, "3", 0);
+	create_file(dir_fd, "1", 0);
+	create_file(dir_fd, "4", 10);
+	assert_oom(dirmodel_notify_file_added_or_changed(&model, "9") != ENOMEM);
+	assert_oom(dirmodel_notify_file_added_or_changed(&model, "5") != ENOMEM);
+	assert_oom(dirmodel_notify_file_added_or_changed(&model, "vanished") != ENOMEM);
+	assert_oom(dirmodel_notify_file_added_or_changed(&model, "3") != ENOMEM);
+	assert_oom(dirmodel_notify_file_added_or_changed(&model, "4") != ENOMEM);
+	assert_oom(dirmodel_notify_file_added_or_changed(&model, "1") != ENOMEM);
+	assert_oom(dirmodel_notify_flush(&model) != ENOMEM);
+
+	/* the changed entry is announced on its own, the new ones together */
+	ck_assert_uint_eq(cb_count, 3);
+	ck_assert_uint_eq(cb_change, MODEL_ADD_BATCH);
+	ck_assert_uint_eq(cb_newindex, 1);
+	ck_assert_uint_eq(cb_oldindex, 4);
+	ck_assert_uint_eq(cb_added_before[0], 0);
+	ck_assert_uint_eq(cb_added_before[1], 2);
+	ck_assert_uint_eq(cb_added_before[2], 3);
+
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 9);
+	for(size_t i = 0; i < 9; i++)
+		ck_assert_str_eq(dirmodel_getfilename(&model, i), names[i]);
+	ck_assert_uint_eq(dirmodel_getdirsize(&model), 10);
+}
+END_TEST
+
+/* a few new entries in a long list are inserted, not merged */
+START_TEST(test_dirmodel_addedfileevent_batch_insert)
+{
+	const size_t oldindexes[] = { 5, 6, 39 };
+
+	cb_count = 0;
+	create_numbered_files(40);
+	assert_oom(listmodel_register_change_callback(&model.listmodel, batch_change_callback, (void *)oldindexes) == true);
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+
+	create_file(dir_fd, "20a", 0);
+	create_file(dir_fd, "05a", 0);
+	assert_oom(dirmodel_notify_file_added_or_changed(&model, "20a") != ENOMEM);
+	assert_oom(dirmodel_notify_file_added_or_changed(&model, "05a") != ENOMEM);
+	assert_oom(dirmodel_notify_flush(&model) != ENOMEM);
+
+	ck_assert_uint_eq(cb_count, 2);
+	ck_assert_uint_eq(cb_change, MODEL_ADD_BATCH);
+	ck_assert_uint_eq(cb_newindex, 6);
+	ck_assert_uint_eq(cb_oldindex, 2);
+	ck_assert_uint_eq(cb_added_before[0], 0);
+	ck_assert_uint_eq(cb_added_before[1], 1);
+	ck_assert_uint_eq(cb_added_before[2], 2);
+
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 42);
+	ck_assert_str_eq(dirmodel_getfilename(&model, 6), "05a");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 22), "20a");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 41), "39");
+}
+END_TEST
+
 START_TEST(test_dirmodel_removedfileevent)
 {
 	cb_count = 0;
@@ -261,6 +399,7 @@ START_TEST(test_dirmodel_removedfileevent)
 
 	assert_oom(dirmodel_change_directory(&model, path) == true);
 	dirmodel_notify_file_deleted(&model, "3");
+	assert_oom(dirmodel_notify_flush(&model) != ENOMEM);
 
 	ck_assert_uint_eq(cb_count, 2);
 	ck_assert_uint_eq(cb_oldindex, 3);
@@ -268,6 +407,103 @@ START_TEST(test_dirmodel_removedfileevent)
 }
 END_TEST
 
+START_TEST(test_dirmodel_removedfileevent_batch)
+{
+	const size_t oldindexes[] = { 0, 3, 8 };
+	const char *names[] = { "00", "02", "04", "05", "06", "08", "09" };
+
+	cb_count = 0;
+	create_numbered_files(10);
+	create_file(dir_fd, "03", 10);
+	assert_oom(listmodel_register_change_callback(&model.listmodel, batch_change_callback, (void *)oldindexes) == true);
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+	assert_oom(dirmodel_regex_setmark(&model, "03", 1) == true);
+	cb_count = 0;
+
+	unlinkat(dir_fd, "07", 0);
+	unlinkat(dir_fd, "03", 0);
+	unlinkat(dir_fd, "01", 0);
+	dirmodel_notify_file_deleted(&model, "07");
+	dirmodel_notify_file_deleted(&model, "03");
+	dirmodel_notify_file_deleted(&model, "unknown");
+	dirmodel_notify_file_deleted(&model, "01");
+	assert_oom(dirmodel_notify_flush(&model) != ENOMEM);
+
+	/* without memory to collect them, they are removed one by one */
+	assert_oom(cb_count == 1);
+	ck_assert_uint_eq(cb_change, MODEL_REMOVE_BATCH);
+	ck_assert_uint_eq(cb_oldindex, 3);
+	ck_assert_uint_eq(cb_removed_before[0], 0);
+	ck_assert_uint_eq(cb_removed_before[1], 1);
+	ck_assert_uint_eq(cb_removed_before[2], 3);
+
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 7);
+	for(size_t i = 0; i < 7; i++)
+		ck_assert_str_eq(dirmodel_getfilename(&model, i), names[i]);
+	ck_assert_uint_eq(dirmodel_getdirsize(&model), 0);
+	ck_assert_uint_eq(dirmodel_getmarkedstats(&model).count, 0);
+	ck_assert_uint_eq(dirmodel_getmarkedstats(&model).size, 0);
+}
+END_TEST
+
+/* a few removed entries in a long list are taken out one by one */
+START_TEST(test_dirmodel_removedfileevent_batch_remove)
+{
+	const size_t oldindexes[] = { 5, 6, 39 };
+
+	cb_count = 0;
+	create_numbered_files(40);
+	assert_oom(listmodel_register_change_callback(&model.listmodel, batch_change_callback, (void *)oldindexes) == true);
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+
+	unlinkat(dir_fd, "20", 0);
+	unlinkat(dir_fd, "05", 0);
+	dirmodel_notify_file_deleted(&model, "20");
+	dirmodel_notify_file_deleted(&model, "05");
+	assert_oom(dirmodel_notify_flush(&model) != ENOMEM);
+
+	assert_oom(cb_count == 2);
+	ck_assert_uint_eq(cb_change, MODEL_REMOVE_BATCH);
+	ck_assert_uint_eq(cb_oldindex, 2);
+	ck_assert_uint_eq(cb_removed_before[0], 0);
+	ck_assert_uint_eq(cb_removed_before[1], 1);
+	ck_assert_uint_eq(cb_removed_before[2], 2);
+
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 38);
+	ck_assert_str_eq(dirmodel_getfilename(&model, 5), "06");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 19), "21");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 37), "39");
+}
+END_TEST
+
+/* only the last event for a name within one flush counts */
+START_TEST(test_dirmodel_removedfileevent_recreated)
+{
+	cb_count = 0;
+	create_file(dir_fd, "a", 0);
+	create_file(dir_fd, "b", 0);
+	create_file(dir_fd, "c", 0);
+	assert_oom(listmodel_register_change_callback(&model.listmodel, change_callback, NULL) == true);
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+
+	unlinkat(dir_fd, "b", 0);
+	dirmodel_notify_file_deleted(&model, "b");
+	create_file(dir_fd, "b", 10);
+	assert_oom(dirmodel_notify_file_added_or_changed(&model, "b") != ENOMEM);
+	create_file(dir_fd, "d", 0);
+	assert_oom(dirmodel_notify_file_added_or_changed(&model, "d") != ENOMEM);
+	unlinkat(dir_fd, "d", 0);
+	dirmodel_notify_file_deleted(&model, "d");
+	assert_oom(dirmodel_notify_flush(&model) != ENOMEM);
+
+	ck_assert_uint_eq(cb_count, 2);
+	ck_assert_uint_eq(cb_change, MODEL_CHANGE);
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 3);
+	ck_assert_str_eq(dirmodel_getfilename(&model, 1), "b");
+	ck_assert_uint_eq(dirmodel_getdirsize(&model), 10);
+}
+END_TEST
+
 START_TEST(test_dirmodel_changedfileevent)
 {
 	cb_count = 0;
@@ -318,6 +554,152 @@ START_TEST(test_dirmodel_changedfileevent_newposition)
 }
 END_TEST
 
+START_TEST(test_dirmodel_changedfileevent_inplace)
+{
+	create_file(dir_fd, "a", 0);
+	create_file(dir_fd, "b", 0);
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+	const struct filedata *filedata = dirmodel_getfiledata(&model, 1);
+
+	create_file(dir_fd, "b", 10);
+	assert_oom(dirmodel_notify_file_added_or_changed(&model, "b") != ENOMEM);
+	assert_oom(dirmodel_notify_flush(&model) != ENOMEM);
+
+	/* the entry keeps its memory, only its stat data changes */
+	ck_assert_ptr_eq(dirmodel_getfiledata(&model, 1), filedata);
+	ck_assert_uint_eq(filedata->size, 10);
+	ck_assert_uint_eq(dirmodel_getdirsize(&model), 10);
+}
+END_TEST
+
+static void age_restats(uint64_t milliseconds)
+{
+	for(size_t i = 0; i < DIRMODEL_RESTAT_SLOTS; i++)
+		model.restats[i].last -= milliseconds;
+}
+
+START_TEST(test_dirmodel_changedfileevent_ratelimit)
+{
+	create_file(dir_fd, "a", 0);
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+
+	/* the first changes are stat'ed at once */
+	for(off_t size = 1; size <= 2; size++) {
+		create_file(dir_fd, "a", size);
+		assert_oom(dirmodel_notify_file_added_or_changed(&model, "a") != ENOMEM);
+		assert_oom(dirmodel_notify_flush(&model) != ENOMEM);
+		ck_assert_uint_eq(dirmodel_getdirsize(&model), size);
+	}
+
+	/* a file, that keeps changing, has to wait */
+	create_file(dir_fd, "a", 3);
+	assert_oom(dirmodel_notify_file_added_or_changed(&model, "a") != ENOMEM);
+	assert_oom(dirmodel_notify_flush(&model) != ENOMEM);
+	assert_oom(dirmodel_getqueuedcount(&model) == 1);
+	ck_assert_uint_eq(dirmodel_getdirsize(&model), 2);
+
+	age_restats(1000);
+	assert_oom(dirmodel_notify_flush(&model) != ENOMEM);
+	ck_assert_uint_eq(dirmodel_getqueuedcount(&model), 0);
+	ck_assert_uint_eq(dirmodel_getdirsize(&model), 3);
+}
+END_TEST
+
+START_TEST(test_dirmodel_changedfileevent_ratelimit_chdir)
+{
+	create_file(dir_fd, "a", 0);
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+	for(off_t size = 1; size <= 2; size++) {
+		create_file(dir_fd, "a", size);
+		assert_oom(dirmodel_notify_file_added_or_changed(&model, "a") != ENOMEM);
+		assert_oom(dirmodel_notify_flush(&model) != ENOMEM);
+	}
+
+	/* the same name in the newly entered directory starts over */
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+	create_file(dir_fd, "a", 3);
+	assert_oom(dirmodel_notify_file_added_or_changed(&model, "a") != ENOMEM);
+	assert_oom(dirmodel_notify_flush(&model) != ENOMEM);
+	ck_assert_uint_eq(dirmodel_getqueuedcount(&model), 0);
+	ck_assert_uint_eq(dirmodel_getdirsize(&model), 3);
+}
+END_TEST
+
+START_TEST(test_dirmodel_changedfileevent_offscreen)
+{
+	create_numbered_files(40);
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+	listmodel_prefetch(&model.listmodel, 0, 10);
+
+	create_file(dir_fd, "05", 10);
+	create_file(dir_fd, "30", 20);
+	assert_oom(dirmodel_notify_file_added_or_changed(&model, "05") != ENOMEM);
+	assert_oom(dirmodel_notify_file_added_or_changed(&model, "30") != ENOMEM);
+	assert_oom(dirmodel_notify_flush(&model) != ENOMEM);
+
+	/* the entry not shown is only stat'ed, once it is needed */
+	ck_assert_uint_eq(dirmodel_getdirsize(&model), 10);
+	ck_assert_uint_eq(dirmodel_getpendingcount(&model), 1);
+
+	listmodel_prefetch(&model.listmodel, 25, 10);
+	assert_oom(dirmodel_getpendingcount(&model) == 0);
+	ck_assert_uint_eq(dirmodel_getdirsize(&model), 30);
+}
+END_TEST
+
+START_TEST(test_dirmodel_changedfileevent_shownshifted)
+{
+	char filename[] = "00";
+
+	create_numbered_files(40);
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+	listmodel_prefetch(&model.listmodel, 10, 10);
+
+	/* the entries removed before the shown ones move them up */
+	for(filename[1] = '0'; filename[1] < '5'; filename[1]++) {
+		unlinkat(dir_fd, filename, 0);
+		dirmodel_notify_file_deleted(&model, filename);
+	}
+	create_file(dir_fd, "14", 10);
+	assert_oom(dirmodel_notify_file_added_or_changed(&model, "14") != ENOMEM);
+	assert_oom(dirmodel_notify_flush(&model) != ENOMEM);
+
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 35);
+	ck_assert_uint_eq(dirmodel_getpendingcount(&model), 0);
+	ck_assert_uint_eq(dirmodel_getdirsize(&model), 10);
+}
+END_TEST
+
+START_TEST(test_dirmodel_changedfileevent_offscreen_sortcache)
+{
+	create_numbered_files(40);
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+	dirmodel_set_sort_mode(&model, DIRMODEL_SIZE);
+	assert_oom(dirmodel_rearrange(&model) == 0);
+	dirmodel_set_sort_mode(&model, DIRMODEL_FILENAME_DESCENDING);
+	assert_oom(dirmodel_rearrange(&model) == 0);
+	dirmodel_set_sort_mode(&model, DIRMODEL_FILENAME);
+	assert_oom(dirmodel_rearrange(&model) == 0);
+	assert_oom(model.sortcache[DIRMODEL_SIZE] != NULL);
+	assert_oom(model.sortcache[DIRMODEL_FILENAME_DESCENDING] != NULL);
+	listmodel_prefetch(&model.listmodel, 0, 10);
+
+	create_file(dir_fd, "30", 20);
+	assert_oom(dirmodel_notify_file_added_or_changed(&model, "30") != ENOMEM);
+	assert_oom(dirmodel_notify_flush(&model) != ENOMEM);
+	ck_assert_uint_eq(dirmodel_getpendingcount(&model), 1);
+
+	/* only the orders, that depend on the size, are dropped */
+	ck_assert(model.sortcache[DIRMODEL_SIZE] == NULL);
+	assert_oom(model.sortcache[DIRMODEL_FILENAME_DESCENDING] != NULL);
+
+	dirmodel_set_sort_mode(&model, DIRMODEL_FILENAME_DESCENDING);
+	assert_oom(dirmodel_rearrange(&model) == 0);
+	ck_assert_str_eq(dirmodel_getfilename(&model, 0), "39");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 9), "30");
+}
+END_TEST
+
 START_TEST(test_dirmodel_addedfileremovedbeforeeventhandled)
 {
 	cb_count = 0;
@@ -365,12 +747,12 @@ START_TEST(test_dirmodel_dirsize_file_and_symlink)
 
 	ck_assert_uint_eq(dirmodel_getdirsize(&model), filesize + strlen("bar"));
 
-	dirmodel_regex_setmark(&model, "bar", 1);
+	assert_oom(dirmodel_regex_setmark(&model, "bar", 1) == true);
 	struct marked_stats stats = dirmodel_getmarkedstats(&model);
 	ck_assert_uint_eq(stats.count, 1);
 	ck_assert_uint_eq(stats.size, strlen("bar"));
 
-	dirmodel_regex_setmark(&model, "bar", 0);
+	assert_oom(dirmodel_regex_setmark(&model, "bar", 0) == true);
 	stats = dirmodel_getmarkedstats(&model);
 	ck_assert_uint_eq(stats.count, 0);
 	ck_assert_uint_eq(stats.size, 0);
@@ -411,7 +793,7 @@ START_TEST(test_dirmodel_dirsize_file_and_symlink_removed)
 	ck_assert_int_eq(symlinkat("foo", dir_fd, "bar"), 0);
 	assert_oom(dirmodel_change_directory(&model, path) == true);
 
-	dirmodel_regex_setmark(&model, "bar", 1);
+	assert_oom(dirmodel_regex_setmark(&model, "bar", 1) == true);
 
 	dirmodel_notify_file_deleted(&model, "bar");
 	assert_oom(dirmodel_notify_flush(&model) != ENOMEM);
@@ -432,7 +814,7 @@ START_TEST(test_dirmodel_dirsize_file_and_symlink_changed)
 	ck_assert_int_eq(symlinkat("foo", dir_fd, "bar"), 0);
 	assert_oom(dirmodel_change_directory(&model, path) == true);
 
-	dirmodel_regex_setmark(&model, "bar", 1);
+	assert_oom(dirmodel_regex_setmark(&model, "bar", 1) == true);
 
 	create_file(dir_fd, "foo", filesize * 2);
 	assert_oom(dirmodel_notify_file_added_or_changed(&model, "foo") != ENOMEM);
@@ -447,6 +829,393 @@ START_TEST(test_dirmodel_dirsize_file_and_symlink_changed)
 }
 END_TEST
 
+START_TEST(test_dirmodel_deferred_load)
+{
+	wchar_t buf[21];
+
+	mkdirat(dir_fd, "dir", 0x700);
+	create_file(dir_fd, "foo", 10);
+	create_file(dir_fd, "bar", 25);
+	ck_assert_int_eq(symlinkat("dir", dir_fd, "link"), 0);
+
+	dirmodel_set_load_mode(&model, DIRMODEL_LOAD_DEFERRED);
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+
+	/* the symlink is stat'ed right away, to know it points to a directory */
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 4);
+	ck_assert_uint_eq(dirmodel_getpendingcount(&model), 3);
+	uint64_t dirsize = dirmodel_getdirsize(&model);
+	ck_assert_str_eq(dirmodel_getfilename(&model, 0), "dir");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 1), "link");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 2), "bar");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 3), "foo");
+	ck_assert(dirmodel_isdir(&model, 0));
+	ck_assert(dirmodel_isdir(&model, 1));
+	ck_assert(!dirmodel_isdir(&model, 2));
+
+	/* rendering a directory does not need a stat */
+	listmodel_render(&model.listmodel, buf, 20, 20, 0);
+	ck_assert_uint_eq(dirmodel_getpendingcount(&model), 3);
+
+	listmodel_render(&model.listmodel, buf, 20, 20, 3);
+	ck_assert_int_eq(wcscmp(buf, L"foo              10 "), 0);
+	ck_assert_uint_eq(dirmodel_getpendingcount(&model), 2);
+	ck_assert_uint_eq(dirmodel_getdirsize(&model), dirsize + 10);
+
+	const struct filedata *filedata = dirmodel_getfiledata(&model, 2);
+	ck_assert(filedata->is_stat_valid);
+	ck_assert_uint_eq(filedata->size, 25);
+	ck_assert_uint_eq(dirmodel_getpendingcount(&model), 1);
+	ck_assert_uint_eq(dirmodel_getdirsize(&model), dirsize + 35);
+}
+END_TEST
+
+START_TEST(test_dirmodel_deferred_load_prefetch)
+{
+	char filename[] = "file0";
+
+	mkdirat(dir_fd, "dir", 0x700);
+	for(size_t i = 0; i < 8; i++) {
+		filename[4] = '0' + i;
+		create_file(dir_fd, filename, 1 << i);
+	}
+
+	dirmodel_set_load_mode(&model, DIRMODEL_LOAD_DEFERRED);
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+	ck_assert_uint_eq(dirmodel_getpendingcount(&model), 9);
+
+	/* "dir" and file0 to file2 */
+	listmodel_prefetch(&model.listmodel, 0, 4);
+	/* prefetching is skipped, when memory is short */
+	assert_oom(dirmodel_getpendingcount(&model) == 6);
+	ck_assert_uint_eq(dirmodel_getdirsize(&model), 7);
+
+	const struct filedata *filedata = dirmodel_getfiledata(&model, 3);
+	ck_assert(!filedata->is_stat_pending);
+	ck_assert_uint_eq(filedata->size, 4);
+	filedata = dirmodel_getfiledata(&model, 4);
+	ck_assert_uint_eq(filedata->size, 8);
+	ck_assert_uint_eq(dirmodel_getpendingcount(&model), 5);
+}
+END_TEST
+
+START_TEST(test_dirmodel_deferred_load_sizesort)
+{
+	create_file(dir_fd, "foo", 10);
+	create_file(dir_fd, "bar", 25);
+
+	dirmodel_set_load_mode(&model, DIRMODEL_LOAD_DEFERRED);
+	dirmodel_set_sort_mode(&model, DIRMODEL_SIZE);
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+
+	ck_assert_uint_eq(dirmodel_getpendingcount(&model), 0);
+	ck_assert_uint_eq(dirmodel_getdirsize(&model), 35);
+	ck_assert_str_eq(dirmodel_getfilename(&model, 0), "foo");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 1), "bar");
+}
+END_TEST
+
+START_TEST(test_dirmodel_sizesort_descending)
+{
+	mkdirat(dir_fd, "bdir", 0x700);
+	mkdirat(dir_fd, "adir", 0x700);
+	create_file(dir_fd, "x", 10);
+	create_file(dir_fd, "y", 20);
+	create_file(dir_fd, "w", 10);
+
+	dirmodel_set_sort_mode(&model, DIRMODEL_SIZE_DESCENDING);
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+
+	/* directories stay first and equal sizes are ordered by name */
+	ck_assert_str_eq(dirmodel_getfilename(&model, 0), "adir");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 1), "bdir");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 2), "y");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 3), "w");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 4), "x");
+}
+END_TEST
+
+START_TEST(test_dirmodel_deferred_load_rearrange)
+{
+	create_file(dir_fd, "a", 30);
+	create_file(dir_fd, "b", 10);
+	create_file(dir_fd, "c", 20);
+
+	dirmodel_set_load_mode(&model, DIRMODEL_LOAD_DEFERRED);
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+	ck_assert_uint_eq(dirmodel_getpendingcount(&model), 3);
+
+	/* sorting by size needs the pending stat data */
+	dirmodel_set_sort_mode(&model, DIRMODEL_SIZE);
+	assert_oom(dirmodel_rearrange(&model) == 0);
+
+	ck_assert_uint_eq(dirmodel_getpendingcount(&model), 0);
+	ck_assert_uint_eq(dirmodel_getdirsize(&model), 60);
+	ck_assert_str_eq(dirmodel_getfilename(&model, 0), "b");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 1), "c");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 2), "a");
+}
+END_TEST
+
+START_TEST(test_dirmodel_sortcache)
+{
+	create_file(dir_fd, "a", 30);
+	create_file(dir_fd, "b", 10);
+	create_file(dir_fd, "c", 20);
+
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+	dirmodel_set_sort_mode(&model, DIRMODEL_SIZE_DESCENDING);
+	assert_oom(dirmodel_rearrange(&model) == 0);
+
+	/* the name order is kept up to date in the background */
+	create_file(dir_fd, "0", 15);
+	assert_oom(dirmodel_notify_file_added_or_changed(&model, "0") != ENOMEM);
+	assert_oom(dirmodel_notify_flush(&model) != ENOMEM);
+	unlinkat(dir_fd, "b", 0);
+	dirmodel_notify_file_deleted(&model, "b");
+	assert_oom(dirmodel_notify_flush(&model) != ENOMEM);
+
+	ck_assert_str_eq(dirmodel_getfilename(&model, 0), "a");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 1), "c");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 2), "0");
+
+	dirmodel_set_sort_mode(&model, DIRMODEL_FILENAME);
+	assert_oom(dirmodel_rearrange(&model) == 0);
+	/* cached lists are dropped, when memory is short */
+	assert_oom(model.sortcache[DIRMODEL_SIZE_DESCENDING] != NULL);
+
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 3);
+	ck_assert_str_eq(dirmodel_getfilename(&model, 0), "0");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 1), "a");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 2), "c");
+
+	dirmodel_set_sort_mode(&model, DIRMODEL_SIZE_DESCENDING);
+	assert_oom(dirmodel_rearrange(&model) == 0);
+	ck_assert_str_eq(dirmodel_getfilename(&model, 0), "a");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 2), "0");
+}
+END_TEST
+
+START_TEST(test_dirmodel_sortcache_disabled)
+{
+	create_file(dir_fd, "a", 30);
+	create_file(dir_fd, "b", 10);
+
+	dirmodel_set_sortcache_limit(&model, 0);
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+	dirmodel_set_sort_mode(&model, DIRMODEL_SIZE);
+	assert_oom(dirmodel_rearrange(&model) == 0);
+
+	for(size_t mode = 0; mode < DIRMODEL_SORT_MODES; mode++)
+		ck_assert(model.sortcache[mode] == NULL);
+	ck_assert_str_eq(dirmodel_getfilename(&model, 0), "b");
+}
+END_TEST
+
+START_TEST(test_dirmodel_deferred_load_mark)
+{
+	create_file(dir_fd, "foo", 10);
+	create_file(dir_fd, "bar", 25);
+
+	dirmodel_set_load_mode(&model, DIRMODEL_LOAD_DEFERRED);
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+
+	listmodel_setmark(&model.listmodel, 1, true);
+	struct marked_stats stats = dirmodel_getmarkedstats(&model);
+	ck_assert_uint_eq(stats.count, 1);
+	ck_assert_uint_eq(stats.size, 10);
+	ck_assert_uint_eq(dirmodel_getpendingcount(&model), 1);
+
+	dirmodel_notify_file_deleted(&model, "bar");
+	assert_oom(dirmodel_notify_flush(&model) != ENOMEM);
+	ck_assert_uint_eq(dirmodel_getpendingcount(&model), 0);
+	ck_assert_uint_eq(dirmodel_getdirsize(&model), 10);
+}
+END_TEST
+
+static void assert_numbered_files(size_t count)
+{
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), count);
+	for(size_t i = 0; i < count; i++) {
+		const char *filename = dirmodel_getfilename(&model, i);
+		ck_assert_int_eq(filename[0], '0' + i / 10);
+		ck_assert_int_eq(filename[1], '0' + i % 10);
+	}
+}
+
+static int wait_for_loading(void)
+{
+	struct pollfd pollfd = { .fd = dirmodel_getloadfd(&model), .events = POLLIN };
+	int ret = 0;
+
+	while(ret == 0 && dirmodel_isloading(&model)) {
+		ck_assert_int_eq(poll(&pollfd, 1, 5000), 1);
+		ret = dirmodel_collect_batches(&model);
+	}
+	return ret;
+}
+
+START_TEST(test_dirmodel_progressive_load)
+{
+	cb_count = 0;
+	create_numbered_files(20);
+	model.first_batch_size = 4;
+
+	assert_oom(listmodel_register_change_callback(&model.listmodel, change_callback, NULL) == true);
+	assert_oom(dirmodel_begin_change_directory(&model, path) == true);
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 0);
+	ck_assert(dirmodel_isloading(&model));
+	ck_assert_uint_eq(cb_count, 1);
+	ck_assert_uint_eq(cb_change, MODEL_RELOAD);
+
+	assert_oom(wait_for_loading() == 0);
+	ck_assert(!dirmodel_isloading(&model));
+	assert_oom(dirmodel_isopen(&model));
+
+	/* the first batch reloads the empty view, the other two are added
+	 * with one notification each */
+	ck_assert_uint_eq(cb_count, 2 + 2);
+	ck_assert_uint_eq(cb_change, MODEL_ADD_BATCH);
+	assert_numbered_files(20);
+}
+END_TEST
+
+START_TEST(test_dirmodel_progressive_load_addedfileevent)
+{
+	char filename[] = "00";
+
+	create_numbered_files(20);
+	model.first_batch_size = 1;
+
+	assert_oom(dirmodel_begin_change_directory(&model, path) == true);
+
+	/* inotify events for entries, that may not be loaded yet */
+	for(size_t i = 0; i < 20; i += 2) {
+		filename[0] = '0' + i / 10;
+		filename[1] = '0' + i % 10;
+		assert_oom(dirmodel_notify_file_added_or_changed(&model, filename) != ENOMEM);
+	}
+	assert_oom(dirmodel_notify_flush(&model) != ENOMEM);
+
+	assert_oom(wait_for_loading() == 0);
+	assert_oom(dirmodel_notify_flush(&model) != ENOMEM);
+
+	assert_numbered_files(20);
+}
+END_TEST
+
+START_TEST(test_dirmodel_progressive_load_nonexistent)
+{
+	assert_oom(dirmodel_begin_change_directory(&model, "/nonexistent") == true);
+	assert_oom(wait_for_loading() == ENOENT);
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 0);
+	ck_assert(!dirmodel_isopen(&model));
+}
+END_TEST
+
+START_TEST(test_dirmodel_progressive_load_cancel)
+{
+	create_numbered_files(20);
+
+	assert_oom(dirmodel_begin_change_directory(&model, path) == true);
+	assert_oom(dirmodel_begin_change_directory(&model, path) == true);
+	assert_oom(wait_for_loading() == 0);
+	assert_numbered_files(20);
+}
+END_TEST
+
+START_TEST(test_dirmodel_progressive_load_deletedfileevent)
+{
+	char filename[] = "00";
+	struct pollfd pollfd = { .fd = dirmodel_getloadfd(&model), .events = POLLIN };
+
+	/* without stat'ing, nothing notices, that a read entry is gone */
+	create_numbered_files(20);
+	dirmodel_set_load_mode(&model, DIRMODEL_LOAD_DEFERRED);
+	model.first_batch_size = 1;
+
+	assert_oom(dirmodel_begin_change_directory(&model, path) == true);
+
+	/* all names are read with the first batch, but the others are not
+	 * taken yet, while the deletions are flushed */
+	ck_assert_int_eq(poll(&pollfd, 1, 5000), 1);
+	int fd = open(path, O_RDONLY);
+	model.dir_fd = fd;
+	for(size_t i = 1; i < 20; i += 2) {
+		filename[0] = '0' + i / 10;
+		filename[1] = '0' + i % 10;
+		ck_assert_int_eq(unlinkat(dir_fd, filename, 0), 0);
+		dirmodel_notify_file_deleted(&model, filename);
+	}
+	assert_oom(dirmodel_notify_flush(&model) != ENOMEM);
+
+	int ret = wait_for_loading();
+	close(fd);
+	assert_oom(ret == 0);
+
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 10);
+	for(size_t i = 0; i < 10; i++) {
+		const char *name = dirmodel_getfilename(&model, i);
+		ck_assert_int_eq((name[0] - '0') * 10 + name[1] - '0', 2 * i);
+	}
+	ck_assert_uint_eq(namequeue_length(&model.loading_deleted), 0);
+}
+END_TEST
+
+START_TEST(test_dirmodel_findprefix_numbered)
+{
+	size_t index;
+
+	create_numbered_files(100);
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+
+	for(size_t i = 0; i < 100; i++) {
+		char prefix[] = { '0' + i / 10, '0' + i % 10, '\0' };
+		assert_oom(dirmodel_find_prefix(&model, prefix, &index));
+		ck_assert_uint_eq(index, i);
+	}
+	assert_oom(dirmodel_find_prefix(&model, "7", &index));
+	ck_assert_uint_eq(index, 70);
+	ck_assert(!dirmodel_find_prefix(&model, "100", &index));
+}
+END_TEST
+
+START_TEST(test_dirmodel_compact)
+{
+	char filename[201];
+
+	/* long names fill several arena chunks quickly */
+	memset(filename, 'x', sizeof(filename) - 1);
+	filename[sizeof(filename) - 1] = '\0';
+	for(size_t i = 0; i < 600; i++) {
+		sprintf(filename, "%03zu", i);
+		filename[3] = 'x';
+		create_file(dir_fd, filename, 0);
+	}
+
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+	size_t capacity = model.arena.capacity;
+
+	for(size_t i = 0; i < 600; i++) {
+		if(i % 4 == 0)
+			continue;
+		sprintf(filename, "%03zu", i);
+		filename[3] = 'x';
+		ck_assert_int_eq(unlinkat(dir_fd, filename, 0), 0);
+		dirmodel_notify_file_deleted(&model, filename);
+	}
+	ck_assert_int_eq(dirmodel_notify_flush(&model), 0);
+
+	assert_oom(model.arena.capacity < capacity);
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 150);
+	for(size_t i = 0; i < 150; i++) {
+		sprintf(filename, "%03zu", i * 4);
+		filename[3] = 'x';
+		ck_assert_str_eq(dirmodel_getfilename(&model, i), filename);
+	}
+}
+END_TEST
+
 static void setup_markfiles(void)
 {
 	setup();
@@ -553,10 +1322,10 @@ START_TEST(test_dirmodel_regexsearch_foundforward)
 {
 	assert_oom(dirmodel_change_directory(&model, path) == true);
 
-	ck_assert(dirmodel_regex_getnext(&model, "foo", 2, -1) == 1);
-	ck_assert(dirmodel_regex_getnext(&model, "bar", 4, -1) == 2);
-	ck_assert(dirmodel_regex_getnext(&model, "ba.", 4, -1) == 3);
-	ck_assert(dirmodel_regex_getnext(&model, "foo", 0, -1) == 0);
+	assert_oom(dirmodel_regex_getnext(&model, "foo", 2, -1) == 1);
+	assert_oom(dirmodel_regex_getnext(&model, "bar", 4, -1) == 2);
+	assert_oom(dirmodel_regex_getnext(&model, "ba.", 4, -1) == 3);
+	assert_oom(dirmodel_regex_getnext(&model, "foo", 1, -1) == 4);
 }
 END_TEST
 
@@ -564,9 +1333,88 @@ START_TEST(test_dirmodel_regexsearch_foundbackward)
 {
 	assert_oom(dirmodel_change_directory(&model, path) == true);
 
-	ck_assert(dirmodel_regex_getnext(&model, "foo", 0, 1) == 1);
-	ck_assert(dirmodel_regex_getnext(&model, "foo", 2, 1) == 4);
-	ck_assert(dirmodel_regex_getnext(&model, "fo.", 2, 1) == 3);
+	assert_oom(dirmodel_regex_getnext(&model, "foo", 0, 1) == 1);
+	assert_oom(dirmodel_regex_getnext(&model, "foo", 2, 1) == 4);
+	assert_oom(dirmodel_regex_getnext(&model, "fo.", 2, 1) == 3);
+}
+END_TEST
+
+START_TEST(test_dirmodel_regexsearch_wraparound)
+{
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+
+	assert_oom(dirmodel_regex_getnext(&model, "BAR", 3, 1) == 0);
+	assert_oom(dirmodel_regex_getnext(&model, "BAR", 0, 1) == 1);
+	assert_oom(dirmodel_regex_getnext(&model, "baz", 3, 1) == 3);
+	assert_oom(dirmodel_regex_getnext(&model, "FOP", 1, -1) == 3);
+	assert_oom(dirmodel_regex_getnext(&model, "^b", 0, -1) == 3);
+	assert_oom(dirmodel_regex_getnext(&model, "^b", SIZE_MAX, 1) == 0);
+}
+END_TEST
+
+START_TEST(test_dirmodel_findprefix)
+{
+	size_t index;
+
+	mkdirat(dir_fd, "bdir", 0700);
+	create_file(dir_fd, "Bat", 0);
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+
+	assert_oom(dirmodel_find_prefix(&model, "", &index));
+	ck_assert_uint_eq(index, 0);
+	assert_oom(dirmodel_find_prefix(&model, "bd", &index));
+	ck_assert_uint_eq(index, 0);
+	assert_oom(dirmodel_find_prefix(&model, "BAZ", &index));
+	ck_assert_uint_eq(index, 5);
+	assert_oom(dirmodel_find_prefix(&model, "foo", &index));
+	ck_assert_uint_eq(index, 6);
+	ck_assert(!dirmodel_find_prefix(&model, "fooo", &index));
+	ck_assert(!dirmodel_find_prefix(&model, "x", &index));
+
+	/* "Bat" is sorted before, but far from where "ba" would go, so it is
+	 * found by its capitalized form and taken, as it comes first */
+	assert_oom(dirmodel_find_prefix(&model, "ba", &index));
+	assert_oom(strcmp(dirmodel_getfilename(&model, index), "Bat") == 0);
+}
+END_TEST
+
+START_TEST(test_dirmodel_findprefix_case)
+{
+	size_t index, foo_index, foobar_index;
+
+	/* bytewise, this is sorted before all lowercase names, far from where
+	 * "foob" would go */
+	create_file(dir_fd, "Foobar.txt", 0);
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+
+	assert_oom(dirmodel_find_prefix(&model, "foob", &index));
+	ck_assert_str_eq(dirmodel_getfilename(&model, index), "Foobar.txt");
+	assert_oom(dirmodel_find_prefix(&model, "FOOBA", &index));
+	ck_assert_str_eq(dirmodel_getfilename(&model, index), "Foobar.txt");
+	ck_assert(!dirmodel_find_prefix(&model, "foobax", &index));
+
+	/* of the names found, the first in the list is taken */
+	ck_assert(dirmodel_get_index(&model, "foo", &foo_index));
+	ck_assert(dirmodel_get_index(&model, "Foobar.txt", &foobar_index));
+	assert_oom(dirmodel_find_prefix(&model, "foo", &index));
+	/* a case form, that could not be probed, may miss the first one */
+	assert_oom(index == (foo_index < foobar_index ? foo_index : foobar_index));
+}
+END_TEST
+
+START_TEST(test_dirmodel_findprefix_sizesort)
+{
+	size_t index;
+
+	create_file(dir_fd, "big", 10);
+	dirmodel_set_sort_mode(&model, DIRMODEL_SIZE_DESCENDING);
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+
+	ck_assert(dirmodel_find_prefix(&model, "b", &index));
+	ck_assert_uint_eq(index, 0);
+	ck_assert(dirmodel_find_prefix(&model, "BAR", &index));
+	ck_assert_uint_eq(index, 1);
+	ck_assert(!dirmodel_find_prefix(&model, "x", &index));
 }
 END_TEST
 
@@ -574,7 +1422,7 @@ START_TEST(test_dirmodel_regexmark)
 {
 	assert_oom(dirmodel_change_directory(&model, path) == true);
 
-	dirmodel_regex_setmark(&model, ".fo", true);
+	assert_oom(dirmodel_regex_setmark(&model, ".fo", true) == true);
 
 	const struct list *list;
 	int ret = dirmodel_getmarkedfilenames(&model, &list);
@@ -593,8 +1441,8 @@ START_TEST(test_dirmodel_regexunmark)
 {
 	assert_oom(dirmodel_change_directory(&model, path) == true);
 
-	dirmodel_regex_setmark(&model, ".*", true);
-	dirmodel_regex_setmark(&model, "foo", false);
+	assert_oom(dirmodel_regex_setmark(&model, ".*", true) == true);
+	assert_oom(dirmodel_regex_setmark(&model, "foo", false) == true);
 
 	const struct list *list;
 	int ret = dirmodel_getmarkedfilenames(&model, &list);
@@ -655,6 +1503,75 @@ START_TEST(test_dirmodel_setfilter_filteraddedfile)
 }
 END_TEST
 
+START_TEST(test_dirmodel_rearrange_filter)
+{
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+	listmodel_setmark(&model.listmodel, 0, true);
+	listmodel_setmark(&model.listmodel, 2, true);
+
+	dirmodel_setfilter(&model, ".fo");
+	assert_oom(dirmodel_rearrange(&model) == 0);
+
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 3);
+	ck_assert_str_eq(dirmodel_getfilename(&model, 0), "barfoo");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 1), "barfop");
+	ck_assert(listmodel_ismarked(&model.listmodel, 1) == true);
+	ck_assert_uint_eq(dirmodel_getmarkedstats(&model).count, 1);
+
+	/* hidden entries still follow the changes in the directory */
+	unlinkat(dir_fd, "foo", 0);
+	dirmodel_notify_file_deleted(&model, "foo");
+	assert_oom(dirmodel_notify_flush(&model) != ENOMEM);
+
+	dirmodel_setfilter(&model, NULL);
+	assert_oom(dirmodel_rearrange(&model) == 0);
+
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 4);
+	ck_assert_str_eq(dirmodel_getfilename(&model, 0), "bar");
+	ck_assert(listmodel_ismarked(&model.listmodel, 0) == true);
+	ck_assert_str_eq(dirmodel_getfilename(&model, 3), "bazfop");
+	ck_assert_uint_eq(dirmodel_getmarkedstats(&model).count, 2);
+}
+END_TEST
+
+START_TEST(test_dirmodel_rearrange_narrowwiden)
+{
+	assert_oom(dirmodel_change_directory(&model, path) == true);
+	listmodel_setmark(&model.listmodel, 2, true);
+
+	dirmodel_setfilter(&model, "ba");
+	assert_oom(dirmodel_rearrange(&model) == 0);
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 4);
+
+	/* typing on only narrows the listing further */
+	dirmodel_setfilter(&model, "bar");
+	/* without a copy of the pattern narrowing cannot be told */
+	assert_oom(model.filter_narrowed);
+	dirmodel_setfilter(&model, "barf");
+	assert_oom(dirmodel_rearrange(&model) == 0);
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 2);
+	ck_assert_str_eq(dirmodel_getfilename(&model, 0), "barfoo");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 1), "barfop");
+	ck_assert(listmodel_ismarked(&model.listmodel, 1) == true);
+
+	/* deleting a character brings hidden entries back in order */
+	dirmodel_setfilter(&model, "fo");
+	ck_assert(!model.filter_narrowed);
+	assert_oom(dirmodel_rearrange(&model) == 0);
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 4);
+	ck_assert_str_eq(dirmodel_getfilename(&model, 0), "barfoo");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 1), "barfop");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 2), "bazfop");
+	ck_assert_str_eq(dirmodel_getfilename(&model, 3), "foo");
+	ck_assert_uint_eq(dirmodel_getmarkedstats(&model).count, 1);
+
+	dirmodel_setfilter(&model, "o$");
+	assert_oom(dirmodel_rearrange(&model) == 0);
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 2);
+	ck_assert_str_eq(dirmodel_getfilter(&model), "o$");
+}
+END_TEST
+
 Suite *dirmodel_suite(void)
 {
 	Suite *suite;
@@ -672,12 +1589,24 @@ Suite *dirmodel_suite(void)
 	tcase_add_test(tcase, test_dirmodel_populateddirectory_linktofile);
 	tcase_add_test(tcase, test_dirmodel_populateddirectory_brokenlink);
 	tcase_add_test(tcase, test_dirmodel_populateddirectory_order);
+	tcase_add_test(tcase, test_dirmodel_populateddirectory_parallelstat);
 	tcase_add_loop_test(tcase, test_dirmodel_render_specialcases, 0, sizeof(renderspecialcasestesttable)/sizeof(renderspecialcasestesttable[0]));
 	tcase_add_test(tcase, test_dirmodel_reloadevent);
 	tcase_add_test(tcase, test_dirmodel_addedfileevent);
+	tcase_add_test(tcase, test_dirmodel_addedfileevent_batch);
+	tcase_add_test(tcase, test_dirmodel_addedfileevent_batch_insert);
 	tcase_add_test(tcase, test_dirmodel_removedfileevent);
+	tcase_add_test(tcase, test_dirmodel_removedfileevent_batch);
+	tcase_add_test(tcase, test_dirmodel_removedfileevent_batch_remove);
+	tcase_add_test(tcase, test_dirmodel_removedfileevent_recreated);
 	tcase_add_test(tcase, test_dirmodel_changedfileevent);
 	tcase_add_test(tcase, test_dirmodel_changedfileevent_newposition);
+	tcase_add_test(tcase, test_dirmodel_changedfileevent_inplace);
+	tcase_add_test(tcase, test_dirmodel_changedfileevent_ratelimit);
+	tcase_add_test(tcase, test_dirmodel_changedfileevent_ratelimit_chdir);
+	tcase_add_test(tcase, test_dirmodel_changedfileevent_offscreen);
+	tcase_add_test(tcase, test_dirmodel_changedfileevent_offscreen_sortcache);
+	tcase_add_test(tcase, test_dirmodel_changedfileevent_shownshifted);
 	tcase_add_test(tcase, test_dirmodel_addedfileremovedbeforeeventhandled);
 	tcase_add_test(tcase, test_dirmodel_statfail);
 	tcase_add_test(tcase, test_dirmodel_dirsize_files);
@@ -685,6 +1614,21 @@ Suite *dirmodel_suite(void)
 	tcase_add_test(tcase, test_dirmodel_dirsize_file_and_symlink_added);
 	tcase_add_test(tcase, test_dirmodel_dirsize_file_and_symlink_removed);
 	tcase_add_test(tcase, test_dirmodel_dirsize_file_and_symlink_changed);
+	tcase_add_test(tcase, test_dirmodel_progressive_load);
+	tcase_add_test(tcase, test_dirmodel_progressive_load_addedfileevent);
+	tcase_add_test(tcase, test_dirmodel_progressive_load_nonexistent);
+	tcase_add_test(tcase, test_dirmodel_progressive_load_cancel);
+	tcase_add_test(tcase, test_dirmodel_progressive_load_deletedfileevent);
+	tcase_add_test(tcase, test_dirmodel_compact);
+	tcase_add_test(tcase, test_dirmodel_findprefix_numbered);
+	tcase_add_test(tcase, test_dirmodel_deferred_load);
+	tcase_add_test(tcase, test_dirmodel_deferred_load_prefetch);
+	tcase_add_test(tcase, test_dirmodel_deferred_load_sizesort);
+	tcase_add_test(tcase, test_dirmodel_sizesort_descending);
+	tcase_add_test(tcase, test_dirmodel_deferred_load_rearrange);
+	tcase_add_test(tcase, test_dirmodel_sortcache);
+	tcase_add_test(tcase, test_dirmodel_sortcache_disabled);
+	tcase_add_test(tcase, test_dirmodel_deferred_load_mark);
 	suite_add_tcase(suite, tcase);
 
 	tcase = tcase_create("Mark Files");
@@ -701,11 +1645,17 @@ Suite *dirmodel_suite(void)
 	tcase_add_test(tcase, test_dirmodel_regexsearch_notfoundbackward);
 	tcase_add_test(tcase, test_dirmodel_regexsearch_foundforward);
 	tcase_add_test(tcase, test_dirmodel_regexsearch_foundbackward);
+	tcase_add_test(tcase, test_dirmodel_regexsearch_wraparound);
+	tcase_add_test(tcase, test_dirmodel_findprefix);
+	tcase_add_test(tcase, test_dirmodel_findprefix_case);
+	tcase_add_test(tcase, test_dirmodel_findprefix_sizesort);
 	tcase_add_test(tcase, test_dirmodel_regexmark);
 	tcase_add_test(tcase, test_dirmodel_regexunmark);
 	tcase_add_test(tcase, test_dirmodel_setfilter_null);
 	tcase_add_test(tcase, test_dirmodel_setfilter_filter);
 	tcase_add_test(tcase, test_dirmodel_setfilter_filteraddedfile);
+	tcase_add_test(tcase, test_dirmodel_rearrange_filter);
+	tcase_add_test(tcase, test_dirmodel_rearrange_narrowwiden);
 	suite_add_tcase(suite, tcase);
 
 	return suite;
@@ -3,7 +3,10 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <locale.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -62,8 +65,8 @@ START_TEST(test_filedata_regularfile)
 	assert_oom(filedata_new_from_file(&filedata, dir_fd, "foo") == 0);
 	ck_assert(filedata != NULL);
 	ck_assert(filedata->is_link == false);
-	ck_assert(filedata->stat.st_size == 1024);
-	ck_assert(S_ISREG(filedata->stat.st_mode));
+	ck_assert(filedata->size == 1024);
+	ck_assert(S_ISREG(filedata->mode));
 	ck_assert(filedata->is_marked == false);
 
 	filedata_delete(filedata);
@@ -81,8 +84,8 @@ START_TEST(test_filedata_link)
 	ck_assert(filedata != NULL);
 	ck_assert(filedata->is_link == true);
 	ck_assert(filedata->is_link_broken == false);
-	ck_assert(filedata->stat.st_size == 2048);
-	ck_assert(S_ISREG(filedata->stat.st_mode));
+	ck_assert(filedata->size == 2048);
+	ck_assert(S_ISREG(filedata->mode));
 	ck_assert(filedata->is_marked == false);
 
 	filedata_delete(filedata);
@@ -99,13 +102,35 @@ START_TEST(test_filedata_linkbroken)
 	ck_assert(filedata != NULL);
 	ck_assert(filedata->is_link == true);
 	ck_assert(filedata->is_link_broken == true);
-	ck_assert(filedata->stat.st_size == 3);
+	ck_assert(filedata->size == 3);
 	ck_assert(filedata->is_marked == false);
 
 	filedata_delete(filedata);
 }
 END_TEST
 
+START_TEST(test_filedata_new_then_stat)
+{
+	struct filedata *filedata;
+
+	create_file(dir_fd, "foo", 512);
+
+	assert_oom(filedata_new(&filedata, "foo") == 0);
+	ck_assert(filedata->is_stat_valid == false);
+	ck_assert(filedata->is_marked == false);
+
+	ck_assert_int_eq(filedata_stat(filedata, dir_fd), 0);
+	ck_assert(filedata->is_stat_valid == true);
+	ck_assert(filedata->size == 512);
+	ck_assert(S_ISREG(filedata->mode));
+
+	ck_assert_int_eq(unlinkat(dir_fd, "foo", 0), 0);
+	ck_assert_int_eq(filedata_stat(filedata, dir_fd), ENOENT);
+
+	filedata_delete(filedata);
+}
+END_TEST
+
 START_TEST(test_filedata_statfail)
 {
 	struct filedata *filedata;
@@ -122,6 +147,104 @@ START_TEST(test_filedata_statfail)
 }
 END_TEST
 
+START_TEST(test_filedata_compact)
+{
+	struct filedata *filedata;
+
+	/* every loaded entry carries this, so keep it small */
+	ck_assert(sizeof(struct filedata) <= 32);
+
+	assert_oom(filedata_new(&filedata, "a rather long file name") == 0);
+	ck_assert_str_eq(filedata->filename, "a rather long file name");
+	ck_assert(filedata->is_stat_pending);
+
+	filedata_delete(filedata);
+}
+END_TEST
+
+static int sign(int value)
+{
+	return (value > 0) - (value < 0);
+}
+
+static void assert_order_matches(int (*compare)(const char *, const char *))
+{
+	const char *names[] = {"a", "B", "b", "\xc3\xa4", "file10", "file9", "Zebra", ".hidden", ""};
+	struct filedata *filedata[sizeof(names) / sizeof(names[0])];
+	size_t count = sizeof(names) / sizeof(names[0]);
+
+	for(size_t i = 0; i < count; i++)
+		assert_oom(filedata_new(&filedata[i], names[i]) == 0);
+
+	for(size_t i = 0; i < count; i++)
+		for(size_t j = 0; j < count; j++)
+			ck_assert_int_eq(sign(filedata_listcompare_directory_filename(&filedata[i], &filedata[j])),
+					sign(compare(names[i], names[j])));
+
+	for(size_t i = 0; i < count; i++)
+		filedata_delete(filedata[i]);
+}
+
+START_TEST(test_filedata_sortkey)
+{
+	assert_order_matches(strcoll);
+}
+END_TEST
+
+START_TEST(test_filedata_sortkey_clocale)
+{
+	char *locale = strdup(setlocale(LC_COLLATE, NULL));
+	assert_oom(locale != NULL);
+
+	setlocale(LC_COLLATE, "C");
+	filedata_init_collation();
+
+	struct filedata *filedata;
+	assert_oom(filedata_new(&filedata, "foo") == 0);
+	ck_assert(!filedata->has_sort_key);
+	filedata_delete(filedata);
+
+	assert_order_matches(strcmp);
+
+	setlocale(LC_COLLATE, locale);
+	filedata_init_collation();
+	free(locale);
+}
+END_TEST
+
+START_TEST(test_filedata_sortkey_missing)
+{
+	char *locale = strdup(setlocale(LC_COLLATE, NULL));
+	assert_oom(locale != NULL);
+
+	if(setlocale(LC_COLLATE, "C.UTF-8") != NULL) {
+		filedata_init_collation();
+
+		/* too long to get a key, so it is compared with strcoll() */
+		char longname[UCHAR_MAX + 2];
+		memset(longname, 'b', sizeof(longname) - 1);
+		longname[sizeof(longname) - 1] = '\0';
+
+		struct filedata *filedata[2];
+		assert_oom(filedata_new(&filedata[0], longname) == 0);
+		assert_oom(filedata_new(&filedata[1], "a") == 0);
+		ck_assert(!filedata[0]->has_sort_key);
+		ck_assert(filedata[1]->has_sort_key);
+
+		ck_assert(filedata_listcompare_directory_filename(&filedata[0], &filedata[1]) > 0);
+		ck_assert(filedata_listcompare_directory_filename(&filedata[1], &filedata[0]) < 0);
+		ck_assert_int_eq(filedata_listcompare_directory_filename(&filedata[0], &filedata[0]), 0);
+
+		filedata_delete(filedata[0]);
+		filedata_delete(filedata[1]);
+	}
+
+	setlocale(LC_COLLATE, locale);
+	filedata_init_collation();
+	free(locale);
+}
+END_TEST
+
 Suite *filedata_suite(void)
 {
 	Suite *suite;
@@ -135,7 +258,12 @@ Suite *filedata_suite(void)
 	tcase_add_test(tcase, test_filedata_regularfile);
 	tcase_add_test(tcase, test_filedata_link);
 	tcase_add_test(tcase, test_filedata_linkbroken);
+	tcase_add_test(tcase, test_filedata_new_then_stat);
 	tcase_add_test(tcase, test_filedata_statfail);
+	tcase_add_test(tcase, test_filedata_compact);
+	tcase_add_test(tcase, test_filedata_sortkey);
+	tcase_add_test(tcase, test_filedata_sortkey_clocale);
+	tcase_add_test(tcase, test_filedata_sortkey_missing);
 	suite_add_tcase(suite, tcase);
 
 	return suite;
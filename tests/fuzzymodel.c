@@ -0,0 +1,210 @@
+/* See LICENSE file for copyright and license details. */
+#include <check.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../src/dirmodel.h"
+#include "../src/fuzzymodel.h"
+#include "../src/util.h"
+#include "tests.h"
+
+#define PATH_TEMPLATE "/tmp/fuzzymodel.XXXXXX"
+
+static struct dirmodel source;
+static struct fuzzymodel model;
+static bool model_initialized;
+static char path[] = PATH_TEMPLATE;
+static int dir_fd;
+
+static void create_file(const char *filename)
+{
+	close(openat(dir_fd, filename, O_CREAT|O_WRONLY, 0777));
+}
+
+static void setup(void)
+{
+	strcpy(path, PATH_TEMPLATE);
+	ck_assert(mkdtemp(path) != NULL);
+	dir_fd = open(path, O_RDONLY);
+	dirmodel_init(&source);
+	model_initialized = false;
+
+	create_file("Makefile");
+	create_file("main.c");
+	create_file("mark");
+	create_file("matcher.c");
+	create_file("fuzzymodel.c");
+	create_file("README.md");
+}
+
+static void teardown(void)
+{
+	if(model_initialized)
+		fuzzymodel_destroy(&model);
+	dirmodel_destroy(&source);
+	close(dir_fd);
+	remove_directory_recursively(path);
+}
+
+static bool init_model(void)
+{
+	if(!dirmodel_change_directory(&source, path))
+		return false;
+	model_initialized = fuzzymodel_init(&model, &source);
+	return model_initialized;
+}
+
+START_TEST(test_fuzzymodel_empty_query)
+{
+	assert_oom(init_model());
+	assert_oom(fuzzymodel_setquery(&model, "") == 0);
+
+	/* everything matches equally, so the listing order is kept */
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 6);
+	for(size_t i = 0; i < 6; i++)
+		ck_assert_str_eq(fuzzymodel_getfilename(&model, i), dirmodel_getfilename(&source, i));
+}
+END_TEST
+
+START_TEST(test_fuzzymodel_ranking)
+{
+	assert_oom(init_model());
+	assert_oom(fuzzymodel_setquery(&model, "MC") == 0);
+
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 3);
+	ck_assert_str_eq(fuzzymodel_getfilename(&model, 0), "main.c");
+	ck_assert_str_eq(fuzzymodel_getfilename(&model, 1), "matcher.c");
+	ck_assert_str_eq(fuzzymodel_getfilename(&model, 2), "fuzzymodel.c");
+
+	assert_oom(fuzzymodel_setquery(&model, "xyz") == 0);
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 0);
+}
+END_TEST
+
+START_TEST(test_fuzzymodel_incremental)
+{
+	assert_oom(init_model());
+	assert_oom(fuzzymodel_setquery(&model, "m") == 0);
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 6);
+
+	/* only the names, that matched before, are scored again */
+	assert_oom(fuzzymodel_setquery(&model, "mk") == 0);
+	ck_assert_uint_eq(model.candidate_count, 2);
+	ck_assert_str_eq(fuzzymodel_getfilename(&model, 0), "Makefile");
+	ck_assert_str_eq(fuzzymodel_getfilename(&model, 1), "mark");
+
+	assert_oom(fuzzymodel_setquery(&model, "mak") == 0);
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 2);
+
+	/* deleting characters needs all names again */
+	assert_oom(fuzzymodel_setquery(&model, "ma") == 0);
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 4);
+}
+END_TEST
+
+START_TEST(test_fuzzymodel_source_changed)
+{
+	assert_oom(init_model());
+	assert_oom(fuzzymodel_setquery(&model, "mat") == 0);
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 1);
+
+	create_file("mat2");
+	assert_oom(dirmodel_notify_file_added_or_changed(&source, "mat2") != ENOMEM);
+	assert_oom(dirmodel_notify_flush(&source) != ENOMEM);
+	ck_assert(!model.candidates_valid);
+
+	assert_oom(fuzzymodel_setquery(&model, "mat2") == 0);
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 1);
+	ck_assert_str_eq(fuzzymodel_getfilename(&model, 0), "mat2");
+
+	/* results outlive the files, they were found for */
+	unlinkat(dir_fd, "mat2", 0);
+	dirmodel_notify_file_deleted(&source, "mat2");
+	assert_oom(dirmodel_notify_flush(&source) != ENOMEM);
+	ck_assert_str_eq(fuzzymodel_getfilename(&model, 0), "mat2");
+
+	wchar_t buffer[11];
+	ck_assert_uint_eq(listmodel_render(&model.listmodel, buffer, 10, 10, 0), 10);
+	ck_assert(wcscmp(buffer, L"mat2      ") == 0);
+}
+END_TEST
+
+START_TEST(test_fuzzymodel_source_compacted)
+{
+	char name[16];
+
+	for(size_t i = 0; i < 3000; i++) {
+		sprintf(name, "%04zu.o", i);
+		create_file(name);
+	}
+	create_file("keep.c");
+
+	/* the hidden entries fill the arena, but are not candidates */
+	assert_oom(dirmodel_setfilter(&source, "\\.c$"));
+	assert_oom(init_model());
+	assert_oom(fuzzymodel_setquery(&model, "k") == 0);
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 1);
+
+	/* deleting them moves the shown entries into a new arena without
+	 * changing the listing */
+	unsigned long generation = source.generation;
+	for(size_t i = 0; i < 3000; i++) {
+		sprintf(name, "%04zu.o", i);
+		unlinkat(dir_fd, name, 0);
+		dirmodel_notify_file_deleted(&source, name);
+	}
+	assert_oom(dirmodel_notify_flush(&source) != ENOMEM);
+	assert_oom(source.generation != generation);
+
+	assert_oom(fuzzymodel_setquery(&model, "ke") == 0);
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), 1);
+	ck_assert_str_eq(fuzzymodel_getfilename(&model, 0), "keep.c");
+}
+END_TEST
+
+START_TEST(test_fuzzymodel_best_results)
+{
+	char name[16];
+
+	for(size_t i = 0; i < FUZZYMODEL_MAX_RESULTS + 100; i++) {
+		sprintf(name, "file%04zu", i);
+		create_file(name);
+	}
+	create_file("zz_fl");
+
+	assert_oom(init_model());
+	assert_oom(fuzzymodel_setquery(&model, "fl") == 0);
+
+	ck_assert_uint_eq(listmodel_count(&model.listmodel), FUZZYMODEL_MAX_RESULTS);
+	ck_assert_str_eq(fuzzymodel_getfilename(&model, 0), "zz_fl");
+	ck_assert_str_eq(fuzzymodel_getfilename(&model, 1), "file0000");
+	ck_assert_str_eq(fuzzymodel_getfilename(&model, FUZZYMODEL_MAX_RESULTS - 1), "file1022");
+	/* all matches stay candidates, not just the shown ones, which includes
+	 * Makefile and fuzzymodel.c */
+	ck_assert_uint_eq(model.candidate_count, FUZZYMODEL_MAX_RESULTS + 103);
+}
+END_TEST
+
+Suite *fuzzymodel_suite(void)
+{
+	Suite *suite;
+	TCase *tcase;
+
+	suite = suite_create("Fuzzymodel");
+
+	tcase = tcase_create("Core");
+	tcase_add_checked_fixture(tcase, setup, teardown);
+	tcase_add_test(tcase, test_fuzzymodel_empty_query);
+	tcase_add_test(tcase, test_fuzzymodel_ranking);
+	tcase_add_test(tcase, test_fuzzymodel_incremental);
+	tcase_add_test(tcase, test_fuzzymodel_source_changed);
+	tcase_add_test(tcase, test_fuzzymodel_source_compacted);
+	tcase_add_test(tcase, test_fuzzymodel_best_results);
+	suite_add_tcase(suite, tcase);
+
+	return suite;
+}
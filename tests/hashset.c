@@ -0,0 +1,137 @@
+/* See LICENSE file for copyright and license details. */
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/hashset.h"
+#include "tests.h"
+
+static struct hashset set;
+
+static const char *string_key(const void *item)
+{
+	return item;
+}
+
+static void setup(void)
+{
+	hashset_init(&set, string_key);
+}
+
+static void teardown(void)
+{
+	hashset_destroy(&set, free);
+}
+
+static bool insert_number(size_t number)
+{
+	char buffer[32];
+
+	sprintf(buffer, "file%zu", number);
+	char *string = strdup(buffer);
+	if(string == NULL)
+		return false;
+	if(!hashset_insert(&set, string)) {
+		free(string);
+		return false;
+	}
+	return true;
+}
+
+START_TEST(test_hashset_empty)
+{
+	size_t position = 0;
+
+	ck_assert_uint_eq(hashset_length(&set), 0);
+	ck_assert_ptr_eq(hashset_get(&set, "foo"), NULL);
+	ck_assert_ptr_eq(hashset_remove(&set, "foo"), NULL);
+	ck_assert_ptr_eq(hashset_next(&set, &position), NULL);
+}
+END_TEST
+
+START_TEST(test_hashset_insert_get)
+{
+	for(size_t i = 0; i < 5000; i++)
+		assert_oom(insert_number(i));
+
+	ck_assert_uint_eq(hashset_length(&set), 5000);
+	ck_assert_str_eq(hashset_get(&set, "file0"), "file0");
+	ck_assert_str_eq(hashset_get(&set, "file4999"), "file4999");
+	ck_assert_ptr_eq(hashset_get(&set, "file5000"), NULL);
+}
+END_TEST
+
+START_TEST(test_hashset_remove)
+{
+	char buffer[32];
+
+	for(size_t i = 0; i < 5000; i++)
+		assert_oom(insert_number(i));
+
+	for(size_t i = 0; i < 5000; i += 2) {
+		sprintf(buffer, "file%zu", i);
+		char *string = hashset_remove(&set, buffer);
+		ck_assert_str_eq(string, buffer);
+		free(string);
+	}
+	ck_assert_uint_eq(hashset_length(&set), 2500);
+
+	/* the remaining items are still reachable after the holes closed */
+	for(size_t i = 0; i < 5000; i++) {
+		sprintf(buffer, "file%zu", i);
+		if(i % 2)
+			ck_assert_str_eq(hashset_get(&set, buffer), buffer);
+		else
+			ck_assert_ptr_eq(hashset_get(&set, buffer), NULL);
+	}
+}
+END_TEST
+
+START_TEST(test_hashset_replace)
+{
+	assert_oom(insert_number(1));
+
+	char *string = strdup("file1");
+	assert_oom(string != NULL);
+
+	char *old = hashset_replace(&set, string);
+	ck_assert(old != string);
+	ck_assert_str_eq(old, "file1");
+	free(old);
+	ck_assert_ptr_eq(hashset_get(&set, "file1"), string);
+	ck_assert_uint_eq(hashset_length(&set), 1);
+}
+END_TEST
+
+START_TEST(test_hashset_next)
+{
+	size_t position = 0, count = 0;
+
+	for(size_t i = 0; i < 100; i++)
+		assert_oom(insert_number(i));
+
+	while(hashset_next(&set, &position))
+		count++;
+	ck_assert_uint_eq(count, 100);
+}
+END_TEST
+
+Suite *hashset_suite(void)
+{
+	Suite *suite;
+	TCase *tcase;
+
+	suite = suite_create("Hashset");
+
+	tcase = tcase_create("Core");
+	tcase_add_checked_fixture(tcase, setup, teardown);
+	tcase_add_test(tcase, test_hashset_empty);
+	tcase_add_test(tcase, test_hashset_insert_get);
+	tcase_add_test(tcase, test_hashset_remove);
+	tcase_add_test(tcase, test_hashset_replace);
+	tcase_add_test(tcase, test_hashset_next);
+	suite_add_tcase(suite, tcase);
+
+	return suite;
+}
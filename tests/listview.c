@@ -11,6 +11,10 @@
 static struct testmodel {
 	struct listmodel listmodel;
 	size_t count;
+	const size_t *insertpoints;
+	size_t added;
+	const size_t *removed_indexes;
+	size_t removed;
 } model;
 
 static struct listview listview;
@@ -58,6 +62,44 @@ static void testmodel_remove(struct testmodel *model, size_t index)
 	listmodel_notify_change(&model->listmodel, MODEL_REMOVE, 0, index);
 }
 
+static size_t testmodel_added_before(struct listmodel *listmodel, size_t oldindex)
+{
+	struct testmodel *model = container_of(listmodel, struct testmodel, listmodel);
+	size_t count = 0;
+
+	while(count < model->added && model->insertpoints[count] <= oldindex)
+		count++;
+	return count;
+}
+
+static void testmodel_add_batch(struct testmodel *model, const size_t *insertpoints, size_t count)
+{
+	model->count += count;
+	model->insertpoints = insertpoints;
+	model->added = count;
+	model->listmodel.added_before = testmodel_added_before;
+	listmodel_notify_change(&model->listmodel, MODEL_ADD_BATCH, insertpoints[0], count);
+}
+
+static size_t testmodel_removed_before(struct listmodel *listmodel, size_t oldindex)
+{
+	struct testmodel *model = container_of(listmodel, struct testmodel, listmodel);
+	size_t count = 0;
+
+	while(count < model->removed && model->removed_indexes[count] < oldindex)
+		count++;
+	return count;
+}
+
+static void testmodel_remove_batch(struct testmodel *model, const size_t *indexes, size_t count)
+{
+	model->count -= count;
+	model->removed_indexes = indexes;
+	model->removed = count;
+	model->listmodel.removed_before = testmodel_removed_before;
+	listmodel_notify_change(&model->listmodel, MODEL_REMOVE_BATCH, 0, count);
+}
+
 static void testmodel_change(struct testmodel *model, size_t newindex, size_t oldindex)
 {
 	listmodel_notify_change(&model->listmodel, MODEL_CHANGE, newindex, oldindex);
@@ -630,6 +672,76 @@ START_TEST(test_listview_modelchange_moveditem_itemnotselected_removedbefore)
 }
 END_TEST
 
+START_TEST(test_listview_modelchange_addbatch)
+{
+	const size_t insertpoints[] = { 10, 20, 25, 40 };
+
+	testmodel_init(&model, 100);
+	assert_oom(create_view() == true);
+
+	/* the entries added at 25 go before the selected one */
+	gotofirst16index25();
+	testmodel_add_batch(&model, insertpoints, 4);
+	ck_assert_uint_eq(listview_getindex(&listview), 28);
+	ck_assert_uint_eq(listview_getfirst(&listview), 19);
+
+	listview_destroy(&listview);
+	testmodel_destroy(&model);
+}
+END_TEST
+
+START_TEST(test_listview_modelchange_addbatchafterindex)
+{
+	const size_t insertpoints[] = { 26, 30 };
+
+	testmodel_init(&model, 100);
+	assert_oom(create_view() == true);
+
+	gotofirst16index25();
+	testmodel_add_batch(&model, insertpoints, 2);
+	ck_assert_uint_eq(listview_getindex(&listview), 25);
+	ck_assert_uint_eq(listview_getfirst(&listview), 16);
+
+	listview_destroy(&listview);
+	testmodel_destroy(&model);
+}
+END_TEST
+
+START_TEST(test_listview_modelchange_removebatch)
+{
+	const size_t indexes[] = { 10, 20, 25, 40 };
+
+	testmodel_init(&model, 100);
+	assert_oom(create_view() == true);
+
+	/* the selected entry is removed, so the one after it is selected */
+	gotofirst16index25();
+	testmodel_remove_batch(&model, indexes, 4);
+	ck_assert_uint_eq(listview_getindex(&listview), 23);
+	ck_assert_uint_eq(listview_getfirst(&listview), 14);
+
+	listview_destroy(&listview);
+	testmodel_destroy(&model);
+}
+END_TEST
+
+START_TEST(test_listview_modelchange_removebatchafterindex)
+{
+	const size_t indexes[] = { 26, 30 };
+
+	testmodel_init(&model, 100);
+	assert_oom(create_view() == true);
+
+	gotofirst16index25();
+	testmodel_remove_batch(&model, indexes, 2);
+	ck_assert_uint_eq(listview_getindex(&listview), 25);
+	ck_assert_uint_eq(listview_getfirst(&listview), 16);
+
+	listview_destroy(&listview);
+	testmodel_destroy(&model);
+}
+END_TEST
+
 START_TEST(test_listview_modelchange_addbeforefirst_smallist)
 {
 	testmodel_init(&model, 10);
@@ -731,6 +843,10 @@ Suite *listview_suite(void)
 	tcase_add_test(tcase, test_listview_modelchange_moveditem_itemselected);
 	tcase_add_test(tcase, test_listview_modelchange_moveditem_itemnotselected_addedbefore);
 	tcase_add_test(tcase, test_listview_modelchange_moveditem_itemnotselected_removedbefore);
+	tcase_add_test(tcase, test_listview_modelchange_addbatch);
+	tcase_add_test(tcase, test_listview_modelchange_addbatchafterindex);
+	tcase_add_test(tcase, test_listview_modelchange_removebatch);
+	tcase_add_test(tcase, test_listview_modelchange_removebatchafterindex);
 	suite_add_tcase(suite, tcase);
 
 	tcase = tcase_create("modelchange_smalllist");
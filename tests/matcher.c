@@ -0,0 +1,202 @@
+/* See LICENSE file for copyright and license details. */
+#include <check.h>
+#include <errno.h>
+#include <string.h>
+
+#include "../src/matcher.h"
+#include "tests.h"
+
+static struct matcher matcher;
+
+static void setup(void)
+{
+	matcher.pattern = NULL;
+}
+
+static void teardown(void)
+{
+	matcher_destroy(&matcher);
+}
+
+START_TEST(test_matcher_literal)
+{
+	assert_oom(matcher_init(&matcher, "Foo") == 0);
+
+	ck_assert_int_eq(matcher.kind, MATCHER_LITERAL);
+	ck_assert(matcher_match(&matcher, "foo"));
+	ck_assert(matcher_match(&matcher, "barFOObar"));
+	ck_assert(matcher_match(&matcher, "barfOo"));
+	ck_assert(!matcher_match(&matcher, "fo"));
+	ck_assert(!matcher_match(&matcher, "f-oo"));
+	ck_assert(!matcher_match(&matcher, ""));
+}
+END_TEST
+
+START_TEST(test_matcher_literal_empty)
+{
+	assert_oom(matcher_init(&matcher, "") == 0);
+
+	ck_assert(matcher_match(&matcher, "foo"));
+	ck_assert(matcher_match(&matcher, ""));
+}
+END_TEST
+
+START_TEST(test_matcher_literal_longname)
+{
+	char name[1000];
+
+	assert_oom(matcher_init(&matcher, "needle") == 0);
+
+	/* the match crosses the border of the search buffer */
+	memset(name, 'x', sizeof(name));
+	memcpy(&name[253], "NEEDLE", 6);
+	name[sizeof(name) - 1] = '\0';
+	ck_assert(matcher_match(&matcher, name));
+
+	memset(name, 'x', sizeof(name));
+	memcpy(&name[990], "needl", 5);
+	name[sizeof(name) - 1] = '\0';
+	ck_assert(!matcher_match(&matcher, name));
+}
+END_TEST
+
+START_TEST(test_matcher_regex)
+{
+	assert_oom(matcher_init(&matcher, "^fo+$") == 0);
+
+	ck_assert_int_eq(matcher.kind, MATCHER_REGEX);
+	ck_assert(matcher_match(&matcher, "FOOO"));
+	ck_assert(!matcher_match(&matcher, "afoo"));
+}
+END_TEST
+
+START_TEST(test_matcher_prefix_suffix)
+{
+	assert_oom(matcher_init(&matcher, "^core") == 0);
+	ck_assert_int_eq(matcher.kind, MATCHER_PREFIX);
+	ck_assert(matcher_match(&matcher, "Core.1234"));
+	ck_assert(!matcher_match(&matcher, "cor"));
+	ck_assert(!matcher_match(&matcher, "xcore"));
+	matcher_destroy(&matcher);
+
+	assert_oom(matcher_init(&matcher, "\\.LOG$") == 0);
+	ck_assert_int_eq(matcher.kind, MATCHER_SUFFIX);
+	ck_assert(matcher_match(&matcher, "messages.log"));
+	ck_assert(!matcher_match(&matcher, "messages_log"));
+	ck_assert(!matcher_match(&matcher, "log"));
+	matcher_destroy(&matcher);
+
+	assert_oom(matcher_init(&matcher, "^foo$") == 0);
+	ck_assert_int_eq(matcher.kind, MATCHER_EXACT);
+	ck_assert(matcher_match(&matcher, "FOO"));
+	ck_assert(!matcher_match(&matcher, "foo2"));
+}
+END_TEST
+
+START_TEST(test_matcher_glob)
+{
+	assert_oom(matcher_init(&matcher, "^a.*b.*c$") == 0);
+	ck_assert_int_eq(matcher.kind, MATCHER_GLOB);
+	ck_assert(matcher_match(&matcher, "abc"));
+	ck_assert(matcher_match(&matcher, "a-B-b-C"));
+	ck_assert(!matcher_match(&matcher, "acb"));
+	ck_assert(!matcher_match(&matcher, "ac"));
+	matcher_destroy(&matcher);
+
+	/* ".*" next to an anchor does not constrain anything */
+	assert_oom(matcher_init(&matcher, "^core.*") == 0);
+	ck_assert_int_eq(matcher.kind, MATCHER_PREFIX);
+	matcher_destroy(&matcher);
+	assert_oom(matcher_init(&matcher, "^.*$") == 0);
+	ck_assert_int_eq(matcher.kind, MATCHER_LITERAL);
+	ck_assert(matcher_match(&matcher, ""));
+}
+END_TEST
+
+/* the specialized matchers have to agree with regexec() */
+START_TEST(test_matcher_compare_regex)
+{
+	const char *patterns[] = {
+		"", "^", "$", "ab", "^ab", "ab$", "^ab$", "a.*b", "^a.*b$", ".*", "^.*",
+		".*$", "a.*.*b", "\\.b", "a\\$", "b.*a.*b", "^.*ab.*$", "B.*",
+	};
+	const char *names[] = {
+		"", "a", "b", "ab", "AB", "ba", "aab", "abb", "a.b", "a$", "bab", "xaby", "a-b-a-b",
+	};
+
+	for(size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++) {
+		regex_t regex;
+		ck_assert_int_eq(regcomp(&regex, patterns[i], REG_EXTENDED | REG_ICASE | REG_NOSUB), 0);
+		assert_oom_cleanup(matcher_init(&matcher, patterns[i]) == 0, regfree(&regex));
+		ck_assert(matcher.kind != MATCHER_REGEX);
+
+		for(size_t j = 0; j < sizeof(names) / sizeof(names[0]); j++)
+			ck_assert(matcher_match(&matcher, names[j]) == (regexec(&regex, names[j], 0, NULL, 0) == 0));
+
+		matcher_destroy(&matcher);
+		regfree(&regex);
+	}
+}
+END_TEST
+
+START_TEST(test_matcher_narrows)
+{
+	struct matcher new;
+	const struct {
+		const char *old;
+		const char *new;
+		bool narrows;
+	} cases[] = {
+		{ "ba", "bar", true },
+		{ "ba", "^BAR", true },
+		{ "ar", "^b.*ar$", true },
+		{ "bar", "ba", false },
+		{ "^ba", "^bar", true },
+		{ "^ba", "bar", false },
+		{ "\\.log$", "x\\.log$", true },
+		{ "\\.log$", "\\.log", false },
+		{ "ba", "ba[r]", false },
+	};
+
+	for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		assert_oom(matcher_init(&matcher, cases[i].old) == 0);
+		assert_oom(matcher_init(&new, cases[i].new) == 0);
+		ck_assert(matcher_narrows(&matcher, &new) == cases[i].narrows);
+		matcher_destroy(&new);
+		matcher_destroy(&matcher);
+	}
+}
+END_TEST
+
+START_TEST(test_matcher_invalid)
+{
+	int ret = matcher_init(&matcher, "fo(o");
+
+	assert_oom(ret != ENOMEM);
+	ck_assert_int_eq(ret, EINVAL);
+	ck_assert_ptr_eq(matcher.pattern, NULL);
+}
+END_TEST
+
+Suite *matcher_suite(void)
+{
+	Suite *suite;
+	TCase *tcase;
+
+	suite = suite_create("Matcher");
+
+	tcase = tcase_create("Core");
+	tcase_add_checked_fixture(tcase, setup, teardown);
+	tcase_add_test(tcase, test_matcher_literal);
+	tcase_add_test(tcase, test_matcher_literal_empty);
+	tcase_add_test(tcase, test_matcher_literal_longname);
+	tcase_add_test(tcase, test_matcher_prefix_suffix);
+	tcase_add_test(tcase, test_matcher_glob);
+	tcase_add_test(tcase, test_matcher_compare_regex);
+	tcase_add_test(tcase, test_matcher_narrows);
+	tcase_add_test(tcase, test_matcher_regex);
+	tcase_add_test(tcase, test_matcher_invalid);
+	suite_add_tcase(suite, tcase);
+
+	return suite;
+}
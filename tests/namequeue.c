@@ -0,0 +1,162 @@
+/* See LICENSE file for copyright and license details. */
+#include <check.h>
+#include <limits.h>
+#include <stdio.h>
+
+#include "../src/namequeue.h"
+#include "tests.h"
+
+static struct namequeue queue;
+
+static void setup(void)
+{
+	namequeue_init(&queue);
+}
+
+static void teardown(void)
+{
+	namequeue_destroy(&queue);
+}
+
+static bool add_numbers(size_t first, size_t count)
+{
+	char name[32];
+
+	for(size_t i = first; i < first + count; i++) {
+		sprintf(name, "file%zu", i);
+		if(!namequeue_add(&queue, name, 0))
+			return false;
+	}
+	return true;
+}
+
+START_TEST(test_namequeue_empty)
+{
+	ck_assert_uint_eq(namequeue_length(&queue), 0);
+	namequeue_clear(&queue);
+	ck_assert_uint_eq(namequeue_length(&queue), 0);
+}
+END_TEST
+
+START_TEST(test_namequeue_distinct)
+{
+	assert_oom(namequeue_add(&queue, "foo", 0));
+	assert_oom(namequeue_add(&queue, "bar", 0));
+	assert_oom(namequeue_add(&queue, "foo", 0));
+	assert_oom(namequeue_add(&queue, "baz", 0));
+	assert_oom(namequeue_add(&queue, "bar", 0));
+
+	/* names keep the order they were added first in */
+	ck_assert_uint_eq(namequeue_length(&queue), 3);
+	ck_assert_str_eq(namequeue_get(&queue, 0), "foo");
+	ck_assert_str_eq(namequeue_get(&queue, 1), "bar");
+	ck_assert_str_eq(namequeue_get(&queue, 2), "baz");
+}
+END_TEST
+
+START_TEST(test_namequeue_tag)
+{
+	assert_oom(namequeue_add(&queue, "foo", 1));
+	assert_oom(namequeue_add(&queue, "bar", 1));
+	assert_oom(namequeue_add(&queue, "foo", 2));
+
+	/* the last tag counts, the first position */
+	ck_assert_uint_eq(namequeue_length(&queue), 2);
+	ck_assert_str_eq(namequeue_get(&queue, 0), "foo");
+	ck_assert_int_eq(namequeue_gettag(&queue, 0), 2);
+	ck_assert_int_eq(namequeue_gettag(&queue, 1), 1);
+}
+END_TEST
+
+START_TEST(test_namequeue_contains)
+{
+	ck_assert(!namequeue_contains(&queue, "foo"));
+	assert_oom(namequeue_add(&queue, "foo", 0));
+	ck_assert(namequeue_contains(&queue, "foo"));
+	ck_assert(!namequeue_contains(&queue, "bar"));
+
+	namequeue_clear(&queue);
+	ck_assert(!namequeue_contains(&queue, "foo"));
+}
+END_TEST
+
+START_TEST(test_namequeue_clear)
+{
+	assert_oom(namequeue_add(&queue, "foo", 0));
+	assert_oom(namequeue_add(&queue, "bar", 0));
+	namequeue_clear(&queue);
+	ck_assert_uint_eq(namequeue_length(&queue), 0);
+
+	/* the slots of the names from before count as unused */
+	assert_oom(namequeue_add(&queue, "bar", 0));
+	ck_assert_uint_eq(namequeue_length(&queue), 1);
+	ck_assert_str_eq(namequeue_get(&queue, 0), "bar");
+}
+END_TEST
+
+START_TEST(test_namequeue_many)
+{
+	char name[32];
+
+	assert_oom(add_numbers(0, 10000));
+	assert_oom(add_numbers(5000, 10000));
+
+	ck_assert_uint_eq(namequeue_length(&queue), 15000);
+	for(size_t i = 0; i < 15000; i++) {
+		sprintf(name, "file%zu", i);
+		ck_assert_str_eq(namequeue_get(&queue, i), name);
+	}
+}
+END_TEST
+
+START_TEST(test_namequeue_shrink)
+{
+	assert_oom(add_numbers(0, 10000));
+	size_t size = queue.size;
+	namequeue_clear(&queue);
+	ck_assert_uint_eq(queue.size, size);
+
+	/* a quiet round after the burst gives its memory back */
+	assert_oom(add_numbers(0, 10));
+	namequeue_clear(&queue);
+	ck_assert_uint_eq(queue.size, 0);
+	ck_assert_ptr_eq(queue.pool, NULL);
+
+	assert_oom(add_numbers(0, 10));
+	ck_assert_uint_eq(namequeue_length(&queue), 10);
+}
+END_TEST
+
+START_TEST(test_namequeue_generation_overflow)
+{
+	assert_oom(namequeue_add(&queue, "foo", 0));
+	queue.generation = UINT_MAX;
+	namequeue_clear(&queue);
+	ck_assert_uint_eq(queue.generation, 1);
+
+	assert_oom(namequeue_add(&queue, "foo", 0));
+	ck_assert_uint_eq(namequeue_length(&queue), 1);
+}
+END_TEST
+
+Suite *namequeue_suite(void)
+{
+	Suite *suite;
+	TCase *tcase;
+
+	suite = suite_create("Namequeue");
+
+	tcase = tcase_create("Core");
+	tcase_add_checked_fixture(tcase, setup, teardown);
+	tcase_add_test(tcase, test_namequeue_empty);
+	tcase_add_test(tcase, test_namequeue_distinct);
+	tcase_add_test(tcase, test_namequeue_tag);
+	tcase_add_test(tcase, test_namequeue_contains);
+	tcase_add_test(tcase, test_namequeue_clear);
+	tcase_add_test(tcase, test_namequeue_many);
+	tcase_add_test(tcase, test_namequeue_shrink);
+	tcase_add_test(tcase, test_namequeue_generation_overflow);
+	suite_add_tcase(suite, tcase);
+
+	return suite;
+}
@@ -0,0 +1,210 @@
+/* See LICENSE file for copyright and license details. */
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/ostree.h"
+#include "tests.h"
+
+#define REFERENCE_SIZE 20000
+
+static struct ostree *tree;
+static size_t reference[REFERENCE_SIZE];
+static size_t reference_length;
+
+static void setup(void)
+{
+	tree = ostree_new();
+	reference_length = 0;
+	srand(1);
+}
+
+static void teardown(void)
+{
+	ostree_delete(tree, NULL);
+}
+
+/* items must not be NULL, which ends the iteration */
+static void assert_reference(void)
+{
+	struct ostree_cursor cursor;
+	size_t i = 0;
+
+	ck_assert_uint_eq(ostree_length(tree), reference_length);
+	for(void *item = ostree_seek(tree, 0, &cursor); item; item = ostree_next(&cursor))
+		ck_assert_uint_eq((size_t)item, reference[i++]);
+	ck_assert_uint_eq(i, reference_length);
+}
+
+static bool reference_insert(size_t index, size_t value)
+{
+	if(!ostree_insert(tree, index, (void *)value))
+		return false;
+	memmove(&reference[index + 1], &reference[index], (reference_length - index) * sizeof(reference[0]));
+	reference[index] = value;
+	reference_length++;
+	return true;
+}
+
+static void reference_remove(size_t index)
+{
+	ostree_remove(tree, index);
+	memmove(&reference[index], &reference[index + 1], (reference_length - index - 1) * sizeof(reference[0]));
+	reference_length--;
+}
+
+static int compare_size(const void *a, const void *b)
+{
+	size_t value1 = *(size_t *)a;
+	size_t value2 = *(size_t *)b;
+
+	return value1 < value2 ? -1 : value1 > value2;
+}
+
+START_TEST(test_ostree_new)
+{
+	assert_oom(tree != NULL);
+
+	ck_assert_uint_eq(ostree_length(tree), 0);
+}
+END_TEST
+
+START_TEST(test_ostree_deletenull)
+{
+	/* test should not crash */
+	ostree_delete(NULL, NULL);
+}
+END_TEST
+
+START_TEST(test_ostree_append)
+{
+	assert_oom(tree != NULL);
+
+	for(size_t i = 0; i < 10000; i++)
+		assert_oom(ostree_append(tree, (void *)i) == true);
+	ck_assert_uint_eq(ostree_length(tree), 10000);
+	for(size_t i = 0; i < 10000; i += 7)
+		ck_assert_uint_eq((size_t)ostree_get_item(tree, i), i);
+	ck_assert_uint_eq((size_t)ostree_get_item(tree, 9999), 9999);
+}
+END_TEST
+
+START_TEST(test_ostree_insert_remove_random)
+{
+	assert_oom(tree != NULL);
+
+	for(size_t i = 0; i < REFERENCE_SIZE; i++)
+		assert_oom(reference_insert(rand() % (reference_length + 1), i + 1) == true);
+	assert_reference();
+
+	/* removing most items makes the tree shrink again */
+	while(reference_length > 100)
+		reference_remove(rand() % reference_length);
+	assert_reference();
+
+	for(size_t i = 0; i < 5000; i++) {
+		if(rand() % 2) {
+			assert_oom(reference_insert(rand() % (reference_length + 1), i + 1) == true);
+		} else if(reference_length > 0) {
+			reference_remove(rand() % reference_length);
+		}
+	}
+	assert_reference();
+
+	while(reference_length > 0)
+		reference_remove(0);
+	assert_reference();
+}
+END_TEST
+
+START_TEST(test_ostree_set_item)
+{
+	assert_oom(tree != NULL);
+
+	for(size_t i = 0; i < 1000; i++)
+		assert_oom(ostree_append(tree, (void *)i) == true);
+	ostree_set_item(tree, 500, (void *)5000);
+	ck_assert_uint_eq((size_t)ostree_get_item(tree, 499), 499);
+	ck_assert_uint_eq((size_t)ostree_get_item(tree, 500), 5000);
+	ck_assert_uint_eq((size_t)ostree_get_item(tree, 501), 501);
+}
+END_TEST
+
+START_TEST(test_ostree_move_item)
+{
+	assert_oom(tree != NULL);
+
+	for(size_t i = 1; i <= 1000; i++)
+		assert_oom(reference_insert(i - 1, i) == true);
+
+	assert_oom(ostree_move_item(tree, 10, 900) == true);
+	ck_assert_uint_eq((size_t)ostree_get_item(tree, 900), 11);
+	ck_assert_uint_eq((size_t)ostree_get_item(tree, 10), 12);
+	ck_assert_uint_eq((size_t)ostree_get_item(tree, 899), 901);
+
+	assert_oom(ostree_move_item(tree, 900, 10) == true);
+	assert_reference();
+}
+END_TEST
+
+START_TEST(test_ostree_find)
+{
+	size_t index;
+
+	assert_oom(tree != NULL);
+
+	ck_assert(!ostree_find_item_or_insertpoint(tree, compare_size, (void *)5, &index));
+	ck_assert_uint_eq(index, 0);
+
+	for(size_t i = 0; i < 1000; i++)
+		assert_oom(ostree_append(tree, (void *)(2 * i)) == true);
+
+	ck_assert(ostree_find_item_or_insertpoint(tree, compare_size, (void *)500, &index));
+	ck_assert_uint_eq(index, 250);
+	ck_assert(!ostree_find_item_or_insertpoint(tree, compare_size, (void *)501, &index));
+	ck_assert_uint_eq(index, 251);
+	ck_assert(!ostree_find_item_or_insertpoint(tree, compare_size, (void *)5000, &index));
+	ck_assert_uint_eq(index, 1000);
+}
+END_TEST
+
+START_TEST(test_ostree_seek)
+{
+	struct ostree_cursor cursor;
+
+	assert_oom(tree != NULL);
+
+	ck_assert_ptr_eq(ostree_seek(tree, 0, &cursor), NULL);
+	ck_assert_ptr_eq(ostree_next(&cursor), NULL);
+
+	for(size_t i = 1; i <= 1000; i++)
+		assert_oom(ostree_append(tree, (void *)i) == true);
+
+	ck_assert_uint_eq((size_t)ostree_seek(tree, 998, &cursor), 999);
+	ck_assert_uint_eq((size_t)ostree_next(&cursor), 1000);
+	ck_assert_ptr_eq(ostree_next(&cursor), NULL);
+}
+END_TEST
+
+Suite *ostree_suite(void)
+{
+	Suite *suite;
+	TCase *tcase;
+
+	suite = suite_create("Ostree");
+
+	tcase = tcase_create("Core");
+	tcase_add_checked_fixture(tcase, setup, teardown);
+	tcase_add_test(tcase, test_ostree_new);
+	tcase_add_test(tcase, test_ostree_deletenull);
+	tcase_add_test(tcase, test_ostree_append);
+	tcase_add_test(tcase, test_ostree_insert_remove_random);
+	tcase_add_test(tcase, test_ostree_set_item);
+	tcase_add_test(tcase, test_ostree_move_item);
+	tcase_add_test(tcase, test_ostree_find);
+	tcase_add_test(tcase, test_ostree_seek);
+	suite_add_tcase(suite, tcase);
+
+	return suite;
+}
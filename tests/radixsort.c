@@ -0,0 +1,70 @@
+/* See LICENSE file for copyright and license details. */
+#include <check.h>
+#include <stdlib.h>
+
+#include "../src/radixsort.h"
+#include "tests.h"
+
+#define ITEM_COUNT 10000
+
+static struct radixsort_item items[ITEM_COUNT];
+
+static void setup(void)
+{
+	srand(1);
+}
+
+START_TEST(test_radixsort_empty)
+{
+	ck_assert_int_eq(radixsort(items, 0), 0);
+}
+END_TEST
+
+START_TEST(test_radixsort_random)
+{
+	for(size_t i = 0; i < ITEM_COUNT; i++) {
+		items[i].key = (uint64_t)rand() << 40 ^ (uint64_t)rand() << 20 ^ (uint64_t)rand();
+		items[i].item = NULL;
+	}
+
+	assert_oom(radixsort(items, ITEM_COUNT) == 0);
+
+	for(size_t i = 1; i < ITEM_COUNT; i++)
+		ck_assert(items[i - 1].key <= items[i].key);
+}
+END_TEST
+
+START_TEST(test_radixsort_stable)
+{
+	/* few distinct keys, which only differ in a single digit */
+	for(size_t i = 0; i < ITEM_COUNT; i++) {
+		items[i].key = (uint64_t)(rand() % 4) << 32;
+		items[i].item = (void *)i;
+	}
+
+	assert_oom(radixsort(items, ITEM_COUNT) == 0);
+
+	for(size_t i = 1; i < ITEM_COUNT; i++) {
+		ck_assert(items[i - 1].key <= items[i].key);
+		if(items[i - 1].key == items[i].key)
+			ck_assert((size_t)items[i - 1].item < (size_t)items[i].item);
+	}
+}
+END_TEST
+
+Suite *radixsort_suite(void)
+{
+	Suite *suite;
+	TCase *tcase;
+
+	suite = suite_create("Radixsort");
+
+	tcase = tcase_create("Core");
+	tcase_add_checked_fixture(tcase, setup, NULL);
+	tcase_add_test(tcase, test_radixsort_empty);
+	tcase_add_test(tcase, test_radixsort_random);
+	tcase_add_test(tcase, test_radixsort_stable);
+	suite_add_tcase(suite, tcase);
+
+	return suite;
+}
@@ -0,0 +1,110 @@
+/* See LICENSE file for copyright and license details. */
+#include <check.h>
+
+#include "../src/refreshscheduler.h"
+#include "tests.h"
+
+static struct refreshscheduler scheduler;
+
+static void setup(void)
+{
+	refreshscheduler_init(&scheduler);
+}
+
+START_TEST(test_refreshscheduler_isolated)
+{
+	ck_assert(!refreshscheduler_isdue(&scheduler, 10000));
+	ck_assert(!refreshscheduler_add_events(&scheduler, 10000, 0));
+
+	/* a change after a quiet time is applied at once */
+	ck_assert(refreshscheduler_add_events(&scheduler, 10000, 1));
+	ck_assert(refreshscheduler_isdue(&scheduler, 10000));
+	refreshscheduler_flushed(&scheduler, 10000, false);
+	ck_assert(!refreshscheduler_isdue(&scheduler, 20000));
+	ck_assert_uint_eq(scheduler.window, 50);
+
+	ck_assert(refreshscheduler_add_events(&scheduler, 20000, 1));
+	ck_assert(refreshscheduler_isdue(&scheduler, 20000));
+}
+END_TEST
+
+START_TEST(test_refreshscheduler_churn)
+{
+	uint64_t now = 10000;
+
+	ck_assert(refreshscheduler_add_events(&scheduler, now, 1));
+	refreshscheduler_flushed(&scheduler, now, false);
+
+	/* events, that keep coming, are collected for a growing window */
+	for(unsigned int window = 50; window <= 800; window *= 2) {
+		ck_assert(refreshscheduler_add_events(&scheduler, now + 1, 1));
+		ck_assert(!refreshscheduler_add_events(&scheduler, now + 2, 10));
+		ck_assert(!refreshscheduler_isdue(&scheduler, now + window - 1));
+		ck_assert(refreshscheduler_isdue(&scheduler, now + window));
+		now += window;
+		refreshscheduler_flushed(&scheduler, now, false);
+	}
+	ck_assert_uint_eq(scheduler.window, 800);
+
+	ck_assert(refreshscheduler_add_events(&scheduler, now + 1, 1));
+	ck_assert(refreshscheduler_isdue(&scheduler, now + 800));
+	now += 800;
+	refreshscheduler_flushed(&scheduler, now, false);
+	ck_assert_uint_eq(scheduler.window, 800);
+
+	/* after the churn ends, the window starts over */
+	now += 2000;
+	ck_assert(refreshscheduler_add_events(&scheduler, now, 1));
+	ck_assert(refreshscheduler_isdue(&scheduler, now));
+	refreshscheduler_flushed(&scheduler, now, false);
+	ck_assert_uint_eq(scheduler.window, 50);
+}
+END_TEST
+
+START_TEST(test_refreshscheduler_more)
+{
+	ck_assert(refreshscheduler_add_events(&scheduler, 10000, 1));
+	refreshscheduler_flushed(&scheduler, 10000, true);
+
+	/* changes left over come a window later, without widening it */
+	ck_assert(!refreshscheduler_isdue(&scheduler, 10049));
+	ck_assert(refreshscheduler_isdue(&scheduler, 10050));
+	refreshscheduler_flushed(&scheduler, 10050, false);
+	ck_assert_uint_eq(scheduler.window, 50);
+	ck_assert(!refreshscheduler_isdue(&scheduler, 20000));
+}
+END_TEST
+
+START_TEST(test_refreshscheduler_rate)
+{
+	ck_assert(refreshscheduler_add_events(&scheduler, 10000, 1));
+	refreshscheduler_flushed(&scheduler, 10000, false);
+	ck_assert_uint_eq(scheduler.rate, 0);
+
+	ck_assert(refreshscheduler_add_events(&scheduler, 10010, 100));
+	refreshscheduler_flushed(&scheduler, 10100, false);
+	ck_assert_uint_eq(scheduler.rate, 250);
+
+	ck_assert(refreshscheduler_add_events(&scheduler, 10110, 100));
+	refreshscheduler_flushed(&scheduler, 10200, false);
+	ck_assert_uint_eq(scheduler.rate, 437);
+}
+END_TEST
+
+Suite *refreshscheduler_suite(void)
+{
+	Suite *suite;
+	TCase *tcase;
+
+	suite = suite_create("Refreshscheduler");
+
+	tcase = tcase_create("Core");
+	tcase_add_checked_fixture(tcase, setup, NULL);
+	tcase_add_test(tcase, test_refreshscheduler_isolated);
+	tcase_add_test(tcase, test_refreshscheduler_churn);
+	tcase_add_test(tcase, test_refreshscheduler_more);
+	tcase_add_test(tcase, test_refreshscheduler_rate);
+	suite_add_tcase(suite, tcase);
+
+	return suite;
+}
@@ -0,0 +1,241 @@
+/* See LICENSE file for copyright and license details. */
+#include <check.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "../src/filedata.h"
+#include "../src/list.h"
+#include "../src/statpool.h"
+#include "../src/uringstat.h"
+#include "../src/util.h"
+#include "tests.h"
+
+#define PATH_TEMPLATE "/tmp/statpool.XXXXXX"
+
+static char path[] = PATH_TEMPLATE;
+static int dir_fd;
+static struct list *list;
+static struct statpool pool;
+
+static void create_temp_directory()
+{
+	strcpy(path, PATH_TEMPLATE);
+	ck_assert(mkdtemp(path) != NULL);
+}
+
+static void create_file(int dir_fd, const char *filename, off_t size)
+{
+	int fd = openat(dir_fd, filename, O_CREAT|O_WRONLY, 0777);
+	if(size > 0) {
+		lseek(fd, size - 1, SEEK_SET);
+		ck_assert_int_eq(write(fd, "\0", 1), 1);
+	}
+	close(fd);
+}
+
+static void setup(void)
+{
+	create_temp_directory();
+	dir_fd = open(path, O_RDONLY);
+	list = list_new(0);
+	statpool_init(&pool);
+	pool.use_io_uring = false;
+}
+
+static void teardown(void)
+{
+	list_delete(list, (list_item_deallocator)filedata_delete);
+	close(dir_fd);
+	remove_directory_recursively(path);
+}
+
+/* every third file is only added to the list, but never created, so it
+ * should vanish from the list */
+static bool fill_list(size_t count)
+{
+	char filename[16];
+
+	for(size_t i = 0; i < count; i++) {
+		struct filedata *filedata;
+
+		sprintf(filename, "%05zu", i);
+		if(i % 3 != 0)
+			create_file(dir_fd, filename, i);
+		if(filedata_new(&filedata, filename) != 0)
+			return false;
+		if(!list_append(list, filedata)) {
+			filedata_delete(filedata);
+			return false;
+		}
+	}
+	return true;
+}
+
+static void check_list(size_t count)
+{
+	char filename[16];
+	size_t index = 0;
+
+	ck_assert_uint_eq(list_length(list), count - (count + 2) / 3);
+
+	for(size_t i = 0; i < count; i++) {
+		if(i % 3 == 0)
+			continue;
+
+		const struct filedata *filedata = list_get_item(list, index++);
+		sprintf(filename, "%05zu", i);
+		ck_assert_str_eq(filedata->filename, filename);
+		ck_assert(filedata->is_stat_valid);
+		ck_assert(S_ISREG(filedata->mode));
+		ck_assert_uint_eq(filedata->size, i);
+	}
+}
+
+START_TEST(test_statpool_empty)
+{
+	assert_oom(list != NULL);
+
+	ck_assert_int_eq(statpool_stat_list(&pool, dir_fd, list, NULL), 0);
+	ck_assert_uint_eq(list_length(list), 0);
+}
+END_TEST
+
+START_TEST(test_statpool_singlethread)
+{
+	assert_oom(list != NULL);
+	assert_oom(fill_list(10));
+
+	pool.threads = 1;
+	assert_oom(statpool_stat_list(&pool, dir_fd, list, NULL) == 0);
+	check_list(10);
+}
+END_TEST
+
+START_TEST(test_statpool_multithread)
+{
+	assert_oom(list != NULL);
+	assert_oom(fill_list(3000));
+
+	pool.threads = 4;
+	assert_oom(statpool_stat_list(&pool, dir_fd, list, NULL) == 0);
+	check_list(3000);
+}
+END_TEST
+
+START_TEST(test_statpool_init)
+{
+	statpool_init(&pool);
+
+	ck_assert(pool.threads >= 1);
+	ck_assert(pool.threads <= 16);
+	ck_assert(pool.use_io_uring == true);
+}
+END_TEST
+
+START_TEST(test_statpool_io_uring)
+{
+	assert_oom(list != NULL);
+	assert_oom(fill_list(3000));
+
+	pool.use_io_uring = true;
+	assert_oom(statpool_stat_list(&pool, dir_fd, list, NULL) == 0);
+	check_list(3000);
+}
+END_TEST
+
+static bool append_file(const char *filename)
+{
+	struct filedata *filedata;
+
+	if(filedata_new(&filedata, filename) != 0)
+		return false;
+	if(!list_append(list, filedata)) {
+		filedata_delete(filedata);
+		return false;
+	}
+	return true;
+}
+
+START_TEST(test_uringstat_links)
+{
+	bool vanished[5];
+
+	create_file(dir_fd, "file", 2048);
+	mkdirat(dir_fd, "dir", 0700);
+	ck_assert_int_eq(symlinkat("file", dir_fd, "filelink"), 0);
+	ck_assert_int_eq(symlinkat("dir", dir_fd, "dirlink"), 0);
+	ck_assert_int_eq(symlinkat("nothing", dir_fd, "brokenlink"), 0);
+
+	assert_oom(list != NULL);
+	assert_oom(append_file("file"));
+	assert_oom(append_file("filelink"));
+	assert_oom(append_file("dirlink"));
+	assert_oom(append_file("brokenlink"));
+	assert_oom(append_file("missing"));
+
+	int ret = uringstat_stat_list(dir_fd, list, vanished);
+	assert_oom(ret != ENOMEM);
+	/* io_uring might be disabled or unsupported, nothing to test then */
+	if(ret != 0)
+		return;
+
+	const struct filedata *filedata = list_get_item(list, 0);
+	ck_assert(!vanished[0]);
+	ck_assert(filedata->is_stat_valid);
+	ck_assert(!filedata->is_link);
+	ck_assert_uint_eq(filedata->size, 2048);
+
+	filedata = list_get_item(list, 1);
+	ck_assert(!vanished[1]);
+	ck_assert(filedata->is_link);
+	ck_assert(!filedata->is_link_broken);
+	ck_assert_uint_eq(filedata->link_size, 4);
+	ck_assert(S_ISREG(filedata->mode));
+	ck_assert_uint_eq(filedata->size, 2048);
+
+	filedata = list_get_item(list, 2);
+	ck_assert(!vanished[2]);
+	ck_assert(filedata->is_link);
+	ck_assert(!filedata->is_link_broken);
+	ck_assert(S_ISDIR(filedata->mode));
+	ck_assert_uint_eq(filedata->size, 0);
+
+	filedata = list_get_item(list, 3);
+	ck_assert(!vanished[3]);
+	ck_assert(filedata->is_link);
+	ck_assert(filedata->is_link_broken);
+	ck_assert_uint_eq(filedata->size, 7);
+
+	ck_assert(vanished[4]);
+}
+END_TEST
+
+Suite *statpool_suite(void)
+{
+	Suite *suite;
+	TCase *tcase;
+
+	suite = suite_create("Statpool");
+
+	tcase = tcase_create("Core");
+	tcase_add_checked_fixture(tcase, setup, teardown);
+	tcase_add_test(tcase, test_statpool_empty);
+	tcase_add_test(tcase, test_statpool_singlethread);
+	tcase_add_test(tcase, test_statpool_multithread);
+	tcase_add_test(tcase, test_statpool_init);
+	suite_add_tcase(suite, tcase);
+
+	tcase = tcase_create("IO uring");
+	tcase_add_checked_fixture(tcase, setup, teardown);
+	tcase_add_test(tcase, test_statpool_io_uring);
+	tcase_add_test(tcase, test_uringstat_links);
+	suite_add_tcase(suite, tcase);
+
+	return suite;
+}
@@ -10,12 +10,21 @@
 #include <unistd.h>
 #include <ncurses.h>
 
+#include "../src/filedata.h"
 #include "tests.h"
 #include "wrapper/alloc.h"
 
 void _nc_freeall();
 
 Suite *list_suite(void);
+Suite *arena_suite(void);
+Suite *ostree_suite(void);
+Suite *hashset_suite(void);
+Suite *radixsort_suite(void);
+Suite *matcher_suite(void);
+Suite *namequeue_suite(void);
+Suite *refreshscheduler_suite(void);
+Suite *fuzzymodel_suite(void);
 Suite *dict_suite(void);
 Suite *listmodel_suite(void);
 Suite *listview_suite(void);
@@ -27,6 +36,8 @@ Suite *keymap_suite(void);
 Suite *processmanager_suite(void);
 Suite *commandline_suite(void);
 Suite *clipboard_suite(void);
+Suite *statpool_suite(void);
+Suite *dirloader_suite(void);
 
 #define MAX_OOM_ITERATIONS 100
 bool mode_oom = false;
@@ -51,6 +62,16 @@ SRunner *create_runner()
 	srunner_add_suite(suite_runner, processmanager_suite());
 	srunner_add_suite(suite_runner, commandline_suite());
 	srunner_add_suite(suite_runner, clipboard_suite());
+	srunner_add_suite(suite_runner, statpool_suite());
+	srunner_add_suite(suite_runner, dirloader_suite());
+	srunner_add_suite(suite_runner, arena_suite());
+	srunner_add_suite(suite_runner, ostree_suite());
+	srunner_add_suite(suite_runner, hashset_suite());
+	srunner_add_suite(suite_runner, radixsort_suite());
+	srunner_add_suite(suite_runner, matcher_suite());
+	srunner_add_suite(suite_runner, namequeue_suite());
+	srunner_add_suite(suite_runner, refreshscheduler_suite());
+	srunner_add_suite(suite_runner, fuzzymodel_suite());
 
 	return suite_runner;
 }
@@ -71,6 +92,7 @@ int main(int argc, char *argv[])
 			"Please set locale to an available one with UTF-8 encoding and rerun tests.");
 		return EXIT_FAILURE;
 	}
+	filedata_init_collation();
 
 	atexit(reset_malloc);
 